@@ -34,7 +34,7 @@ int32_t ServiceListDescriptor::parse(const uint8_t* buf)
 	while (p < last)
 	{
 		service_lists_.emplace_back(
-			(p[0] << 4) | p[1],		// ServiceID
+			(p[0] << 8) | p[1],		// ServiceID
 			p[2]					// ServiceType
 		);
 		p += 3;
@@ -35,7 +35,7 @@ public:
 	int32_t size() const { return data_size_; }
 	uint8_t descriptor_tag() const { return descriptor_tag_; }
 	uint8_t descriptor_length() const { return descriptor_length_; }
-	const std::vector<ServiceList> service_lists() const { return service_lists_; }
+	const std::vector<ServiceList>& service_lists() const { return service_lists_; }
 
 	void clear();
 	int32_t parse(const uint8_t* buf);
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "TSHeaderBatch.h"
+#include "TSPacket.h"
+
+namespace TS
+{
+
+bool HeaderBatch::simd()
+{
+#if defined(__AVX2__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void HeaderBatch::decode(const uint8_t* buf, size_t packets)
+{
+	pids_.resize(packets);
+	continuity_counters_.resize(packets);
+	flags_.resize(packets);
+
+	auto done = decode_avx2(buf, packets);
+	decode_scalar(buf, done, packets);
+}
+
+void HeaderBatch::decode_scalar(const uint8_t* buf, size_t begin, size_t end)
+{
+	for (auto i = begin; i < end; i++)
+	{
+		const auto* p = buf + i * Packet::size();
+		pids_[i] = static_cast<uint16_t>(((p[1] & 0x1f) << 8) | p[2]);
+		continuity_counters_[i] = p[3] & 0x0f;
+		flags_[i] = static_cast<uint8_t>((p[1] & 0xe0) | (p[3] >> 4) | ((p[0] != 0x47) ? NO_SYNC_BYTE : 0));
+	}
+}
+
+#if defined(__AVX2__)
+size_t HeaderBatch::decode_avx2(const uint8_t* buf, size_t packets)
+{
+	// 16パケット分のヘッダ4バイトを2回のgatherで読み込み、32bitの各要素から項目を取り出す
+	// 16bit、8bitへの詰め直しはレーン毎に行われるためpermuteで順序を戻す
+	const auto index = _mm256_setr_epi32(0, 188, 188 * 2, 188 * 3, 188 * 4, 188 * 5, 188 * 6, 188 * 7);
+	const auto sync = _mm256_set1_epi32(0x47);
+	const auto byte_mask = _mm256_set1_epi32(0xff);
+	const auto pid_mask = _mm256_set1_epi32(0x1fff);
+	const auto cc_mask = _mm256_set1_epi32(0x0f);
+	const auto zero = _mm256_setzero_si256();
+
+	auto decode8 = [&](const uint8_t* p, __m256i& pid, __m256i& cc, __m256i& flags) {
+		auto w = _mm256_i32gather_epi32(reinterpret_cast<const int*>(p), index, 1);
+		// w = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24
+		auto hi = _mm256_and_si256(_mm256_srli_epi32(w, 8), byte_mask);
+		auto lo = _mm256_and_si256(_mm256_srli_epi32(w, 16), byte_mask);
+		pid = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi32(hi, 8), lo), pid_mask);
+		cc = _mm256_and_si256(_mm256_srli_epi32(w, 24), cc_mask);
+		auto no_sync = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(w, byte_mask), sync), _mm256_set1_epi32(NO_SYNC_BYTE));
+		flags = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(hi, _mm256_set1_epi32(0xe0)), _mm256_srli_epi32(w, 28)), no_sync);
+	};
+
+	size_t i = 0;
+	for (; i + 16 <= packets; i += 16)
+	{
+		__m256i pid0, cc0, flags0, pid1, cc1, flags1;
+		decode8(buf + i * Packet::size(), pid0, cc0, flags0);
+		decode8(buf + (i + 8) * Packet::size(), pid1, cc1, flags1);
+
+		auto pid = _mm256_permute4x64_epi64(_mm256_packus_epi32(pid0, pid1), 0xd8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pids_.data() + i), pid);
+
+		auto cc = _mm256_permute4x64_epi64(_mm256_packus_epi32(cc0, cc1), 0xd8);
+		cc = _mm256_permute4x64_epi64(_mm256_packus_epi16(cc, zero), 0xd8);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(continuity_counters_.data() + i), _mm256_castsi256_si128(cc));
+
+		auto flags = _mm256_permute4x64_epi64(_mm256_packus_epi32(flags0, flags1), 0xd8);
+		flags = _mm256_permute4x64_epi64(_mm256_packus_epi16(flags, zero), 0xd8);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(flags_.data() + i), _mm256_castsi256_si128(flags));
+	}
+
+	return i;
+}
+#else
+size_t HeaderBatch::decode_avx2(const uint8_t*, size_t)
+{
+	return 0;
+}
+#endif
+
+}
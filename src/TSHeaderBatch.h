@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace TS
+{
+
+// 188バイトに揃えたパケット列のTSヘッダを項目毎の配列(pid, cc, flags)に展開する
+// 検査や統計の処理はパケット毎のHeaderの代わりにこの配列を順に読む
+class HeaderBatch
+{
+public:
+	// flagsのビット
+	static constexpr uint8_t TRANSPORT_ERROR = 0x80;
+	static constexpr uint8_t PAYLOAD_START = 0x40;
+	static constexpr uint8_t PRIORITY = 0x20;
+	static constexpr uint8_t NO_SYNC_BYTE = 0x10;
+	static constexpr uint8_t SCRAMBLING = 0x0c;
+	static constexpr uint8_t ADAPTATION_FIELD = 0x02;
+	static constexpr uint8_t PAYLOAD = 0x01;
+
+	HeaderBatch() = default;
+	virtual ~HeaderBatch() = default;
+
+	size_t size() const { return pids_.size(); }
+	const std::vector<uint16_t>& pids() const { return pids_; }
+	const std::vector<uint8_t>& continuity_counters() const { return continuity_counters_; }
+	const std::vector<uint8_t>& flags() const { return flags_; }
+
+	// AVX2が有効な場合はgatherで8パケットずつ展開する
+	void decode(const uint8_t* buf, size_t packets);
+	static bool simd();
+
+private:
+	std::vector<uint16_t> pids_;
+	std::vector<uint8_t> continuity_counters_;
+	std::vector<uint8_t> flags_;
+
+	void decode_scalar(const uint8_t* buf, size_t begin, size_t end);
+	size_t decode_avx2(const uint8_t* buf, size_t packets);
+};
+
+}
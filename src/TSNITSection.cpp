@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <string>
 #include <sstream>
@@ -105,28 +107,33 @@ bool NITHeader::parse_nit_header(const uint8_t* packet)
 	if (payload_start_indicator())
 	{
 		pointer_field_ = packet[4];
-		auto p = &packet[5] + pointer_field_;
-		table_id_ = p[0];
-
-		section_syntax_indicator_ = (p[1] & 0x08) ? true : false;
-		section_length_ = ((p[1] & 0x0f) << 8) | p[2];
-		network_id_ = (p[3] << 8) | p[4];
-		version_number_ = (p[5] & 0x3e) >> 1;
-		current_next_indicator_ = (p[5] & 0x01) ? true : false;
-		section_number_ = p[6];
-		last_section_number_ = p[7];
-		network_descriptors_length_ = ((p[8] & 0x0f) << 8) | p[9];
-
-		auto i = 0x0a + network_descriptors_length_;
-		transport_stream_loop_length_ = ((p[i] & 0x0f) << 8) | p[i + 1];
-		on_update_ = true;
-
-		data_size_ = 1 + pointer_field_ + 10 + network_descriptors_length_ + 2;
+		parse_section(&packet[5] + pointer_field_);
 	}
 
 	return true;
 }
 
+void NITHeader::parse_section(const uint8_t* p)
+{
+	// pointer_fieldの直後(セクションの先頭)から解析する
+	table_id_ = p[0];
+
+	section_syntax_indicator_ = (p[1] & 0x08) ? true : false;
+	section_length_ = ((p[1] & 0x0f) << 8) | p[2];
+	network_id_ = (p[3] << 8) | p[4];
+	version_number_ = (p[5] & 0x3e) >> 1;
+	current_next_indicator_ = (p[5] & 0x01) ? true : false;
+	section_number_ = p[6];
+	last_section_number_ = p[7];
+	network_descriptors_length_ = ((p[8] & 0x0f) << 8) | p[9];
+
+	auto i = 0x0a + network_descriptors_length_;
+	transport_stream_loop_length_ = ((p[i] & 0x0f) << 8) | p[i + 1];
+	on_update_ = true;
+
+	data_size_ = 1 + pointer_field_ + 10 + network_descriptors_length_ + 2;
+}
+
 std::string NITHeader::show() const
 {
 	std::ostringstream os;
@@ -169,42 +176,88 @@ void NITSection::clear()
 	ts_headers_.clear();
 	nit_header_.clear();
 	payload_buf_.clear();
+	packet_buf_.clear();
+	packet_offsets_.clear();
+}
+
+void NITSection::reset()
+{
+	// 別の入力に使い回すため、確保済みの領域は残したまま全ての状態を戻す
+	Packet::clear();
+	clear();
+	nit_packets_ = 0;
+	section_offset_ = 0;
+	complete_offset_ = 0;
+	transport_descriptors_.clear();
 }
 
 void NITSection::push(const uint8_t* buf, const size_t size)
 {
 	if (size == 0) { return; }
 
-	auto sync_size = sync(buf, size);
+	push_synced(sync(buf, size));
+}
+
+void NITSection::finish()
+{
+	push_synced(flush());
+}
+
+void NITSection::push_synced(const size_t sync_size)
+{
 	if (sync_size == 0) { return; }
 
+	if (packet_handler_)
+	{
+		packet_handler_(*this, buffer().data(), sync_size);
+	}
+	if (sync_only_ || (hold_first_ && on_update_)) { return; }
+
+	push_packets(buffer().data(), sync_size);
+}
+
+void NITSection::push_packets(const uint8_t* buf, const size_t size)
+{
+	// 同期済みのパケット列を処理する
+	// 同期バッファ以外から渡された場合、セクションの入力上の位置は分からない
 	NITHeader nit;
-	auto last = buffer().data() + sync_size;
-	for (auto p = buffer().data(); p < last; p += Packet::size())
+	auto synced = buf == buffer().data();
+	auto last = buf + size;
+	for (auto p = buf; p < last; p += Packet::size())
 	{
 		if (!nit.parse_nit_header(p)) { continue; }
+		nit_packets_++;
 
+		// チャンネル設定はBSのNITから作るため、BS以外のネットワークは組み立てない
 		if (nit.payload_start_indicator()
 			&& nit.table_id() == 0x40
 			&& nit.current_next_indicator()
 			&& nit.network_id() == 0x0004
 			)
 		{
-			if (nit_header_.version_number() != nit.version_number())
+			if (nit_header_.version_number() != nit.version_number() || section_handler_)
 			{
 				clear();
 				total_packets_ = static_cast<int32_t>((nit.section_length() + 4 + 183) / Packet::payload_size());
 				packet_counter_ = 1;
+				section_offset_ = synced ? input_offset(p - buf) : 0;
 				nit_header_ = nit;
 				on_update_ = false;
 				ts_headers_.reserve(total_packets_);
 				ts_headers_.emplace_back(nit);
 				payload_buf_.resize(total_packets_ * Packet::payload_size());
 				std::copy(p + Header::size(), p + Packet::size(), payload_buf_.data());
+				packet_buf_.assign(p, p + Packet::size());
+				packet_offsets_.assign(1, section_offset_);
 				if (total_packets_ > 1)
 				{
 					has_next_packet_ = true;
 				}
+				else
+				{
+					complete_offset_ = section_offset_;
+					complete();
+				}
 			}
 			else
 			{
@@ -219,12 +272,13 @@ void NITSection::push(const uint8_t* buf, const size_t size)
 			{
 				ts_headers_.emplace_back(nit);
 				std::copy(p + Header::size(), p + Packet::size(), payload_buf_.data() + packet_counter_ * Packet::payload_size());
+				packet_buf_.insert(packet_buf_.end(), p, p + Packet::size());
+				packet_offsets_.push_back(synced ? input_offset(p - buf) : 0);
 				packet_counter_++;
 				if (packet_counter_ == total_packets_)
 				{
-					has_next_packet_ = false;
-					on_update_ = true;
-					parse();
+					complete_offset_ = packet_offsets_.back();
+					complete();
 				}
 			}
 			else
@@ -239,6 +293,106 @@ void NITSection::push(const uint8_t* buf, const size_t size)
 	}
 }
 
+void NITSection::resume(uint64_t input_bytes, const std::vector<uint8_t>& rest, const std::vector<uint8_t>& packets, uint64_t section_offset)
+{
+	// 組み立て途中のパケットを処理し直し、同期の残りを戻して続きから読み込めるようにする
+	reset();
+	push_packets(packets.data(), packets.size() / Packet::size() * Packet::size());
+	if (has_next_packet_)
+	{
+		section_offset_ = section_offset;
+	}
+	restore(input_bytes, rest);
+}
+
+bool NITSection::push_section(const uint8_t* buf, const size_t size, uint64_t offset)
+{
+	// CRCを含むセクション単体からNITを組み立てる
+	// パケットの同期とTSヘッダの解析は行わない
+	if (size < 12 || buf[0] != 0x40) { return false; }
+	size_t section_size = 3 + (((buf[1] & 0x0f) << 8) | buf[2]);
+	size_t header_size = 10 + (((buf[8] & 0x0f) << 8) | buf[9]) + 2;
+	if (section_size > size || header_size > section_size) { return false; }
+
+	auto total_packets = static_cast<int32_t>((section_size + 1 + Packet::payload_size() - 1) / Packet::payload_size());
+	std::vector<uint8_t> payload(total_packets * Packet::payload_size(), 0xff);
+	payload[0] = 0x00;
+	std::copy(buf, buf + section_size, payload.begin() + 1);
+
+	NITHeader nit;
+	nit.parse_section(buf);
+
+	clear();
+	nit_header_ = nit;
+	total_packets_ = total_packets;
+	packet_counter_ = total_packets;
+	section_offset_ = offset;
+	complete_offset_ = offset;
+
+	// TSに書き戻せるよう連続性指標を増やしながらパケットも作る
+	std::array<uint8_t, PACKET_SIZE> packet{SYNC_BYTE, 0x40, 0x10, 0x10};
+	for (int32_t i = 0; i < total_packets; i++)
+	{
+		packet[1] = i == 0 ? 0x40 : 0x00;
+		packet[3] = static_cast<uint8_t>(0x10 | (i & 0x0f));
+		std::copy(payload.begin() + i * Packet::payload_size(), payload.begin() + (i + 1) * Packet::payload_size(), packet.begin() + Header::size());
+		packet_buf_.insert(packet_buf_.end(), packet.begin(), packet.end());
+	}
+	payload_buf_ = std::move(payload);
+	complete();
+
+	return on_update_;
+}
+
+std::vector<uint8_t> NITSection::section() const
+{
+	if (!on_update_) { return {}; }
+
+	size_t offset = 1 + nit_header_.pointer_field();
+	size_t size = 3 + nit_header_.section_length();
+	if (offset + size > payload_buf_.size()) { return {}; }
+
+	return std::vector<uint8_t>(payload_buf_.begin() + offset, payload_buf_.begin() + offset + size);
+}
+
+uint32_t NITSection::crc() const
+{
+	// セクション末尾のCRC_32
+	size_t offset = 1 + nit_header_.pointer_field() + 3 + nit_header_.section_length() - 4;
+	if (!on_update_ || offset + 4 > payload_buf_.size()) { return 0; }
+
+	const auto* p = payload_buf_.data() + offset;
+	return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+void NITSection::complete()
+{
+	// CRCが一致しないセクションは破棄して次のセクションを待つ
+	has_next_packet_ = false;
+	if (!validate())
+	{
+		clear();
+		return;
+	}
+
+	on_update_ = true;
+	parse();
+
+	if (section_handler_)
+	{
+		section_handler_(*this);
+	}
+}
+
+bool NITSection::validate() const
+{
+	size_t offset = 1 + nit_header_.pointer_field();
+	size_t size = 3 + nit_header_.section_length();
+	if (offset + size > payload_buf_.size()) { return false; }
+
+	return Packet::crc32(payload_buf_.data() + offset, size) == 0;
+}
+
 void NITSection::parse()
 {
 	//      +0 +1 +2 +3 +4 +5 +6 +7 +8 +9 +A +B +C +D +E +F
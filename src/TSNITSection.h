@@ -3,7 +3,9 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "TSPacket.h"
@@ -65,6 +67,7 @@ public:
 
 	void clear();
 	bool parse_nit_header(const uint8_t* packet);
+	void parse_section(const uint8_t* section);
 	std::string show() const;
 
 protected:
@@ -90,12 +93,40 @@ public:
 	virtual ~NITSection() = default;
 
 	bool on_update() const { return on_update_; }
+	bool in_progress() const { return has_next_packet_; }
+	const NITHeader& header() const { return nit_header_; }
 	const std::vector<Header>& headers() const { return ts_headers_; }
 	const std::vector<uint8_t>& payloads() const { return payload_buf_; }
+	// 揃ったセクションを運んだ188バイトのパケット
+	const std::vector<uint8_t>& packets() const { return packet_buf_; }
 	const std::vector<TranspoteDescriptor>& transport_descriptors() const { return transport_descriptors_; }
+	uint64_t nit_packets() const { return nit_packets_; }
+	// 揃ったセクションの先頭パケットの入力の先頭からの位置
+	uint64_t section_offset() const { return section_offset_; }
+	// 揃ったセクションの最後のパケットの入力の先頭からの位置
+	uint64_t complete_offset() const { return complete_offset_; }
+	// 揃ったセクションを運んだ各パケットの入力の先頭からの位置
+	const std::vector<uint64_t>& packet_offsets() const { return packet_offsets_; }
+	std::vector<uint8_t> section() const;
+	uint32_t crc() const;
+
+	// 設定した場合は同じバージョンのセクションも毎回組み立て、CRCが一致する度に呼び出す
+	void set_section_handler(std::function<void(const NITSection&)> handler) { section_handler_ = std::move(handler); }
+	// 設定した場合は同期した188バイトのパケット列を毎回渡す
+	void set_packet_handler(std::function<void(const NITSection&, const uint8_t*, size_t)> handler) { packet_handler_ = std::move(handler); }
+	// 設定した場合は最初に揃ったNITを保持し、以降は同期とパケットの受け渡しのみ行う
+	void set_hold_first(bool hold) { hold_first_ = hold; }
+	// 設定した場合はセクションを組み立てず、同期とパケットの受け渡しのみ行う
+	void set_sync_only(bool sync_only) { sync_only_ = sync_only; }
 
 	void clear();
+	void reset();
 	void push(const uint8_t* buf, const size_t size);
+	// 入力の終端で持ち越した最後のパケットを処理する
+	void finish();
+	void push_packets(const uint8_t* buf, const size_t size);
+	void resume(uint64_t input_bytes, const std::vector<uint8_t>& rest, const std::vector<uint8_t>& packets, uint64_t section_offset);
+	bool push_section(const uint8_t* buf, const size_t size, uint64_t offset = 0);
 	std::string show() const;
 
 private:
@@ -103,12 +134,24 @@ private:
 	bool has_next_packet_ = false;
 	int32_t packet_counter_ = 0;
 	int32_t total_packets_ = 0;
+	uint64_t nit_packets_ = 0;
+	uint64_t section_offset_ = 0;
+	uint64_t complete_offset_ = 0;
 	NITHeader nit_header_;
 
 	std::vector<Header> ts_headers_;
 	std::vector<uint8_t> payload_buf_;
+	std::vector<uint8_t> packet_buf_;
+	std::vector<uint64_t> packet_offsets_;
 	std::vector<TranspoteDescriptor> transport_descriptors_;
-
+	std::function<void(const NITSection&)> section_handler_;
+	std::function<void(const NITSection&, const uint8_t*, size_t)> packet_handler_;
+	bool hold_first_ = false;
+	bool sync_only_ = false;
+
+	void push_synced(const size_t sync_size);
+	void complete();
+	bool validate() const;
 	void parse();
 };
 
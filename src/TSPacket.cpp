@@ -3,11 +3,35 @@
 #include <cstdint>
 #include <cstddef>
 #include <algorithm>
+#include <array>
 #include "TSPacket.h"
 
 namespace TS
 {
 
+namespace
+{
+
+constexpr std::array<uint32_t, 256> make_crc32_table()
+{
+	// CRC-32/MPEG-2 (多項式 0x04c11db7)
+	std::array<uint32_t, 256> table{};
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc = i << 24;
+		for (auto j = 0; j < 8; j++)
+		{
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+constexpr auto CRC32_TABLE = make_crc32_table();
+
+}
+
 uint32_t Packet::bcd_to_dec(const uint8_t* p, size_t bytes)
 {
 	uint32_t value = 0;
@@ -37,40 +61,176 @@ uint32_t Packet::bcd_to_dec(const uint8_t* p, size_t bytes)
 	return value;
 }
 
+uint32_t Packet::crc32(const uint8_t* p, size_t bytes)
+{
+	// セクション末尾のCRCを含めて計算すると正常な場合は0になる
+	uint32_t crc = 0xffffffff;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		crc = (crc << 8) ^ CRC32_TABLE[((crc >> 24) ^ p[i]) & 0xff];
+	}
+
+	return crc;
+}
+
+uint64_t Packet::input_offset(size_t sync_pos) const
+{
+	// sync_buf_上の位置を含む区間から入力の位置を求める
+	auto it = std::upper_bound(sync_runs_.begin(), sync_runs_.end(), sync_pos,
+		[](size_t pos, const std::pair<size_t, uint64_t>& run) { return pos < run.first; });
+	if (it == sync_runs_.begin()) { return 0; }
+	--it;
+
+	// 区間内はパケット毎に入力上のパケット長ずつ進む
+	auto pos = sync_pos - it->first;
+	auto stride = stride_ ? stride_ : PACKET_SIZE;
+	return it->second + pos / PACKET_SIZE * stride + pos % PACKET_SIZE;
+}
+
 void Packet::clear()
 {
 	rest_buf_.clear();
 	sync_buf_.clear();
+	sync_runs_.clear();
+	input_bytes_ = 0;
+	sync_packets_ = 0;
+	first_sync_offset_ = 0;
+	sync_losses_ = 0;
+	stride_ = 0;
+}
+
+void Packet::restore(uint64_t input_bytes, const std::vector<uint8_t>& rest)
+{
+	// 保存した読み込み位置と持ち越したデータから続きを同期できるようにする
+	rest_buf_ = rest;
+	sync_buf_.clear();
+	sync_runs_.clear();
+	input_bytes_ = input_bytes;
 }
 
 size_t Packet::sync(const uint8_t* buf, const size_t size)
 {
 	if (size == 0) { return 0; }
+	input_bytes_ += size;
 
 	// 前回の残りに今回の分を結合
 	auto rest_size = rest_buf_.size();
 	rest_buf_.resize(rest_size + size);
 	std::copy(buf, buf + size, rest_buf_.begin() + rest_size);
 
+	// パケット長が決まるまでは188バイトとして同期しながら判定を続ける
+	if (stride_ == 0)
+	{
+		stride_ = detect(rest_buf_.data(), rest_buf_.size());
+	}
+
+	size_t sync_size = 0;
+	switch (stride_)
+	{
+	case M2TS_PACKET_SIZE:
+		sync_size = align<M2TS_PACKET_SIZE>();
+		break;
+	case RS_PACKET_SIZE:
+		sync_size = align<RS_PACKET_SIZE>();
+		break;
+	default:
+		sync_size = align<PACKET_SIZE>();
+		break;
+	}
+
+	if (sync_packets_ == 0 && sync_size > 0)
+	{
+		first_sync_offset_ = input_offset(0);
+	}
+	sync_packets_ += sync_size / PACKET_SIZE;
+
+	return sync_size;
+}
+
+size_t Packet::flush()
+{
+	// 同期済みのパケットに続く188バイト以上が同期バイトから始まる場合のみ
+	if (sync_packets_ == 0 || rest_buf_.size() < PACKET_SIZE || rest_buf_[0] != SYNC_BYTE) { return 0; }
+
+	sync_buf_.assign(rest_buf_.begin(), rest_buf_.begin() + PACKET_SIZE);
+	sync_runs_.assign(1, {0, input_bytes_ - rest_buf_.size()});
+	rest_buf_.clear();
+	sync_packets_++;
+
+	return PACKET_SIZE;
+}
+
+int32_t Packet::detect_stride(const uint8_t* buf, size_t size)
+{
+	auto stride = detect(buf, size);
+
+	return stride ? stride : PACKET_SIZE;
+}
+
+int32_t Packet::detect(const uint8_t* buf, size_t size)
+{
+	// 同期バイトがパケット長の間隔でDETECT_PACKETS個続く位置を探す
+	// 192バイト(M2TS)は先頭4バイトのタイムスタンプ、204バイトは末尾16バイトのパリティを除いて188バイトにする
+	constexpr int32_t strides[] = {PACKET_SIZE, M2TS_PACKET_SIZE, RS_PACKET_SIZE};
+	for (size_t i = 0; i < size; i++)
+	{
+		if (buf[i] != SYNC_BYTE) { continue; }
+
+		for (auto stride : strides)
+		{
+			if (i + static_cast<size_t>(stride) * (DETECT_PACKETS - 1) >= size) { continue; }
+
+			auto found = true;
+			for (auto k = 1; k < DETECT_PACKETS && found; k++)
+			{
+				found = buf[i + k * stride] == SYNC_BYTE;
+			}
+			if (found) { return stride; }
+		}
+	}
+
+	return 0;
+}
+
+template <int32_t Stride>
+size_t Packet::align()
+{
+	// パケット長を定数として展開し、188バイトのパケットに揃えてsync_buf_へ書き出す
 	// 2パケット未満の場合は処理しない
-	if (rest_buf_.size() < PACKET_SIZE * 2) { return 0; }
+	if (rest_buf_.size() < Stride * 2) { return 0; }
 
 	size_t sync_size = 0;
 	auto src = rest_buf_.cbegin();
 	auto last = rest_buf_.cend();
+	auto base = input_bytes_ - rest_buf_.size();
+	auto next = last;
+	// 前回同期したパケットから連続する位置、途切れた場合は同期外れとして数える
+	auto expected = sync_packets_ > 0 ? rest_buf_.cbegin() : last;
 
 	sync_buf_.resize(rest_buf_.size());
+	sync_runs_.clear();
 	auto dst = sync_buf_.begin();
-	while (src < last - PACKET_SIZE)
+	while (src < last - Stride)
 	{
-		if ((src[0] != SYNC_BYTE) || (src[PACKET_SIZE] != SYNC_BYTE))
+		if ((src[0] != SYNC_BYTE) || (src[Stride] != SYNC_BYTE))
 		{
 			src++;
 			continue;
 		}
 
+		if (src != next)
+		{
+			sync_runs_.emplace_back(sync_size, base + std::distance(rest_buf_.cbegin(), src));
+		}
+		if (src != expected && expected != last)
+		{
+			sync_losses_++;
+		}
+		next = src + Stride;
+		expected = next;
+
 		std::copy(src, src + PACKET_SIZE, dst);
-		src += PACKET_SIZE;
+		src += Stride;
 		dst += PACKET_SIZE;
 		sync_size += PACKET_SIZE;
 	}
@@ -3,6 +3,8 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <utility>
 #include <vector>
 
 namespace TS
@@ -18,21 +20,54 @@ public:
 	static int32_t header_size() { return HEADER_SIZE; }
 	static int32_t payload_size() { return PAYLOAD_SIZE; }
 	static uint32_t bcd_to_dec(const uint8_t* p, size_t bytes);
+	static uint32_t crc32(const uint8_t* p, size_t bytes);
+	// 入力の先頭付近からパケット長(188, 192, 204)を判定する、判定できない場合は188
+	static int32_t detect_stride(const uint8_t* buf, size_t size);
 
 	const std::vector<uint8_t>& buffer() const { return sync_buf_; }
+	// 同期できずに次回へ持ち越したデータ
+	const std::vector<uint8_t>& rest() const { return rest_buf_; }
+	uint64_t input_bytes() const { return input_bytes_; }
+	uint64_t sync_packets() const { return sync_packets_; }
+	// 同期したパケットの間に同期できないデータが入った回数
+	uint64_t sync_losses() const { return sync_losses_; }
+	uint64_t input_offset(size_t sync_pos) const;
+	// 最初に同期したパケットの入力の先頭からの位置
+	uint64_t first_sync_offset() const { return first_sync_offset_; }
+	// 入力のパケット長(188, 192, 204)、判定前は0
+	int32_t stride() const { return stride_; }
+	// 判定に十分な量を読み込んでもTSのパケットが見つからない
+	bool not_ts() const { return stride_ == 0 && input_bytes_ >= DETECT_LIMIT; }
 	void clear();
+	void restore(uint64_t input_bytes, const std::vector<uint8_t>& rest);
 	size_t sync(const uint8_t* buf, const size_t size);
+	// 入力の終端で次の同期バイトを確認できずに持ち越した最後のパケットを同期済みにする
+	size_t flush();
 
 protected:
 	static constexpr int32_t PACKET_SIZE = 188;
 	static constexpr int32_t HEADER_SIZE = 4;
 	static constexpr int32_t PAYLOAD_SIZE = PACKET_SIZE - HEADER_SIZE;
+	static constexpr int32_t M2TS_PACKET_SIZE = 192;
+	static constexpr int32_t RS_PACKET_SIZE = 204;
 	static constexpr int32_t SYNC_SIZE = PACKET_SIZE * 5;
+	static constexpr int32_t DETECT_PACKETS = 8;
+	static constexpr uint64_t DETECT_LIMIT = 4 * 1024 * 1024;
 	static constexpr uint8_t SYNC_BYTE = 0x47;
 
 private:
 	std::vector<uint8_t> sync_buf_;
 	std::vector<uint8_t> rest_buf_;
+	// 同期したパケットが連続する区間毎の(sync_buf_上の位置, 入力の先頭からの位置)
+	std::vector<std::pair<size_t, uint64_t>> sync_runs_;
+	uint64_t input_bytes_ = 0;
+	uint64_t sync_packets_ = 0;
+	uint64_t first_sync_offset_ = 0;
+	uint64_t sync_losses_ = 0;
+	int32_t stride_ = 0;
+
+	static int32_t detect(const uint8_t* buf, size_t size);
+	template <int32_t Stride> size_t align();
 };
 
 }
@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "json.hpp"
+
+#include "batch.h"
+#include "budget.h"
+#include "check.h"
+#include "convert.h"
+#include "input.h"
+#include "lineup.h"
+#include "profile.h"
+
+namespace
+{
+	std::mutex log_mutex;
+}
+
+Batch::Batch(const Config& config) :
+	config_(config)
+{
+	if (!config_.cache_dir().empty())
+	{
+		cache_ = std::make_unique<Cache>(config_.cache_dir());
+	}
+}
+
+int32_t Batch::run()
+{
+	// 出力ファイル名が重複しないよう入力毎のラベルを決めておく
+	std::unordered_map<std::string, int32_t> seen;
+	results_.resize(config_.inputs().size());
+	for (size_t i = 0; i < results_.size(); i++)
+	{
+		auto& r = results_[i];
+		r.input = config_.inputs()[i];
+		r.label = Lineup::label(r.input);
+		auto count = ++seen[r.label];
+		if (count > 1)
+		{
+			r.label += '_' + std::to_string(count);
+		}
+	}
+
+	if (config_.sequential())
+	{
+		sequential();
+	}
+	else
+	{
+		auto jobs = std::min<size_t>(std::max(config_.jobs(), 1), results_.size());
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < jobs; i++)
+		{
+			threads.emplace_back(&Batch::worker, this);
+		}
+		for (auto& t : threads)
+		{
+			t.join();
+		}
+	}
+
+	write_summary();
+
+	auto failed = std::count_if(results_.begin(), results_.end(), [](const Result& r) { return !r.ok; });
+	return failed ? 1 : 0;
+}
+
+void Batch::worker()
+{
+	// NITSectionと読み込みバッファはスレッド毎に使い回す
+	TS::NITSection nit;
+	std::vector<uint8_t> buf(config_.buffer_size());
+
+	while (true)
+	{
+		auto index = next_++;
+		if (index >= results_.size()) { break; }
+
+		process(results_[index], nit, buf);
+	}
+}
+
+void Batch::sequential()
+{
+	// HDDでシークが競合しないよう1ファイルずつ処理し、
+	// 読み込みを終えてから出力を書き込む間に次のファイルの先頭をページキャッシュへ読み込ませておく
+	TS::NITSection nit;
+	std::vector<uint8_t> buf(config_.buffer_size());
+
+	for (size_t i = 0; i < results_.size(); i++)
+	{
+		if (i + 1 < results_.size())
+		{
+			const auto& next = results_[i + 1].input;
+			process(results_[i], nit, buf, [this, &next] { readahead(next); });
+		}
+		else
+		{
+			process(results_[i], nit, buf);
+		}
+	}
+}
+
+void Batch::readahead(const std::string& input) const
+{
+#if !defined(_WIN32)
+	auto fd = ::open(input.c_str(), O_RDONLY);
+	if (fd < 0) { return; }
+
+	auto size = READAHEAD_BYTES;
+	if (config_.max_bytes() && config_.max_bytes() < size)
+	{
+		size = config_.max_bytes();
+	}
+	::posix_fadvise(fd, 0, static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+	::close(fd);
+#endif
+}
+
+void Batch::process(Result& result, TS::NITSection& nit, std::vector<uint8_t>& buf, const std::function<void()>& scanned)
+{
+	auto start = std::chrono::steady_clock::now();
+	nit.reset();
+
+	// 検査や集計をする場合はキャッシュを使わず入力の最後まで読む
+	Check check;
+	Profile profile;
+	if (config_.full_scan())
+	{
+		nit.set_packet_handler([this, &check, &profile](const TS::NITSection& packet, const uint8_t* buf, size_t size) {
+			if (config_.check()) { check.push(packet, buf, size); }
+			if (config_.profile()) { profile.push(buf, size); }
+		});
+		nit.set_hold_first(true);
+	}
+
+	try
+	{
+		// 前回と同じファイルであれば走査せずに保存済みのNITを使う
+		auto key = cache_ && !config_.full_scan() ? Cache::key(result.input) : std::string();
+		result.cached = !key.empty() && cache_->load(key, nit);
+		auto found = result.cached || scan(result.input, nit, buf);
+		if (scanned) { scanned(); }
+		if (found)
+		{
+			if (!key.empty() && !result.cached)
+			{
+				cache_->store(key, nit);
+			}
+
+			for (const auto& format : config_.formats())
+			{
+				auto chsets = Lineup::chsets(nit, config_.sorting(format));
+				auto filename = Lineup::output_path(config_.output_dir(), result.label, format);
+				Lineup::write(filename, Convert::dump(format, chsets));
+				result.outputs.emplace_back(filename);
+			}
+			result.ok = true;
+		}
+		else
+		{
+			result.error = "NIT packets not found";
+		}
+
+		if (config_.profile())
+		{
+			auto filename = Lineup::output_file(config_.output_dir(), result.label + "_profile.json");
+			Lineup::write(filename, profile.json().dump(4) + '\n');
+			result.outputs.emplace_back(filename);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	result.input_bytes = nit.input_bytes();
+	result.sync_packets = nit.sync_packets();
+	result.nit_packets = nit.nit_packets();
+	if (result.ok)
+	{
+		result.network_id = nit.header().network_id();
+		result.version_number = nit.header().version_number();
+		result.offset = nit.section_offset();
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (config_.check())
+	{
+		result.check = check.json();
+	}
+	nit.set_packet_handler(nullptr);
+
+	std::lock_guard<std::mutex> lock(log_mutex);
+	std::cerr << result.input << ": ";
+	if (!result.ok)
+	{
+		std::cerr << result.error;
+	}
+	for (size_t i = 0; i < result.outputs.size(); i++)
+	{
+		std::cerr << (i ? ", " : "") << result.outputs[i];
+	}
+	std::cerr << '\n';
+	if (config_.check())
+	{
+		std::cerr << check.report();
+	}
+}
+
+bool Batch::scan(const std::string& input, TS::NITSection& nit, std::vector<uint8_t>& buf)
+{
+	std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(input.c_str(), "rb"), &std::fclose);
+	if (!fp)
+	{
+		throw std::runtime_error("failed to open " + input);
+	}
+
+#if !defined(_WIN32)
+	if (config_.sequential())
+	{
+		::posix_fadvise(::fileno(fp.get()), 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+#endif
+
+	Budget budget(config_.max_bytes(), config_.timeout());
+	auto in = Input::open_file(fp.get(), buf);
+	in->set_max_bytes(config_.max_bytes());
+	in->drain(nit, budget, [this, &nit] { return nit.on_update() && !config_.full_scan(); });
+
+	return nit.on_update();
+}
+
+void Batch::write_summary() const
+{
+	auto j = nlohmann::json::object();
+	j["files"] = nlohmann::json::array();
+
+	uint64_t ok = 0;
+	uint64_t bytes = 0;
+	double seconds = 0;
+	for (const auto& r : results_)
+	{
+		auto f = nlohmann::json::object();
+		f["input"] = r.input;
+		f["ok"] = r.ok;
+		f["cached"] = r.cached;
+		if (r.ok)
+		{
+			f["outputs"] = r.outputs;
+			f["network_id"] = r.network_id;
+			f["version"] = r.version_number;
+			f["offset"] = r.offset;
+		}
+		else
+		{
+			f["error"] = r.error;
+		}
+		f["bytes"] = r.input_bytes;
+		f["packets"] = r.sync_packets;
+		f["nit_packets"] = r.nit_packets;
+		f["seconds"] = r.seconds;
+		if (!r.check.is_null())
+		{
+			f["check"] = r.check;
+		}
+		j["files"].push_back(f);
+
+		ok += r.ok ? 1 : 0;
+		bytes += r.input_bytes;
+		seconds += r.seconds;
+	}
+
+	j["total"] = {
+		{"files", results_.size()},
+		{"ok", ok},
+		{"failed", results_.size() - ok},
+		{"bytes", bytes},
+		{"seconds", seconds},
+	};
+	if (cache_)
+	{
+		j["cache"] = {
+			{"hits", cache_->hits()},
+			{"misses", cache_->misses()},
+		};
+	}
+
+	Lineup::write(Lineup::output_file(config_.output_dir(), "summary.json"), j.dump(4) + '\n');
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "cache.h"
+#include "config.h"
+#include "TSNITSection.h"
+
+// 多数のTSファイルをスレッドプールで走査し、ファイル毎の出力と集計JSONを作成する
+class Batch
+{
+public:
+	Batch(const Config& config);
+	virtual ~Batch() = default;
+
+	struct Result
+	{
+		std::string input;
+		std::string label;
+		std::vector<std::string> outputs;
+		std::string error;
+		bool ok = false;
+		bool cached = false;
+		uint64_t input_bytes = 0;
+		uint64_t sync_packets = 0;
+		uint64_t nit_packets = 0;
+		uint16_t network_id = 0;
+		uint8_t version_number = 0xff;
+		uint64_t offset = 0;
+		double seconds = 0;
+		// --checkの結果
+		nlohmann::json check;
+	};
+
+	int32_t run();
+
+	// 1つの入力を走査し、NITが揃った場合は全ての形式で出力する
+	// scannedは入力の読み込みを終えた時点で呼び出す
+	void process(Result& result, TS::NITSection& nit, std::vector<uint8_t>& buf, const std::function<void()>& scanned = nullptr);
+
+private:
+	// 順次処理で次のファイルを先読みする先頭からのバイト数
+	// NITは通常先頭の数MB以内に揃うため、それ以上は読み込ませない
+	static constexpr uint64_t READAHEAD_BYTES = 4 * 1024 * 1024;
+
+	const Config& config_;
+	std::vector<Result> results_;
+	std::atomic<size_t> next_ = 0;
+	std::unique_ptr<Cache> cache_;
+
+	void worker();
+	void sequential();
+	void readahead(const std::string& input) const;
+	bool scan(const std::string& input, TS::NITSection& nit, std::vector<uint8_t>& buf);
+	void write_summary() const;
+};
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "json.hpp"
+
+#include "bisect.h"
+#include "lineup.h"
+
+Bisect::Bisect(const Config& config) :
+	config_(config),
+	probe_(config.input(), config.probe_window(), config.buffer_size(), config.timeout())
+{
+}
+
+std::string Bisect::run()
+{
+	auto window = probe_.window_size();
+	auto last = probe_.file_size() > window ? probe_.file_size() - window : 0;
+	last -= last % probe_.stride();
+
+	TS::NITSection head;
+	TS::NITSection tail;
+	if (!probe_.window(0, head) || !probe_.window(last, tail))
+	{
+		throw std::runtime_error("NIT packets not found. Check recorded channel or time.\n"
+			"read " + std::to_string(probe_.input_bytes()) + " bytes in " + std::to_string(probe_.windows()) + " windows");
+	}
+
+	// 変化前のバージョンを含む窓(lo)と変化後のバージョンを含む窓(hi)の間を
+	// 1窓(NITの送出間隔以上)まで狭める
+	auto version = head.header().version_number();
+	uint64_t lo = 0;
+	uint64_t hi = last;
+	if (tail.header().version_number() != version)
+	{
+		while (hi - lo > window)
+		{
+			auto mid = lo + (hi - lo) / 2;
+			mid -= mid % probe_.stride();
+
+			// NITが揃わない窓(破損等)は不明として後ろの窓で判定し、
+			// hiまで見つからない場合は変化がmidより前にあるものとして狭める
+			TS::NITSection nit;
+			auto pos = mid;
+			while (pos < hi && !probe_.window(pos, nit))
+			{
+				pos += window;
+				pos -= pos % probe_.stride();
+			}
+			if (pos >= hi)
+			{
+				hi = mid;
+				continue;
+			}
+
+			if (nit.header().version_number() == version)
+			{
+				lo = pos;
+				head = nit;
+			}
+			else
+			{
+				hi = pos;
+				tail = nit;
+			}
+		}
+	}
+
+	auto j = nlohmann::json::object();
+	j["input"] = config_.input();
+	j["size"] = probe_.file_size();
+	j["changed"] = tail.header().version_number() != version;
+	j["before"] = {
+		{"offset", head.section_offset()},
+		{"network_id", head.header().network_id()},
+		{"version", head.header().version_number()},
+		{"lineup", Lineup::chsets(head, config_.sorting()).json()},
+	};
+	if (j["changed"])
+	{
+		// 変化後のバージョンで最初に揃ったセクションの先頭パケットの位置
+		j["offset"] = tail.section_offset();
+		j["after"] = {
+			{"offset", tail.section_offset()},
+			{"network_id", tail.header().network_id()},
+			{"version", tail.header().version_number()},
+			{"lineup", Lineup::chsets(tail, config_.sorting()).json()},
+		};
+	}
+	j["windows"] = probe_.windows();
+	j["bytes"] = probe_.input_bytes();
+
+	return j.dump(4);
+}
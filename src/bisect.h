@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "config.h"
+#include "probe.h"
+#include "TSNITSection.h"
+
+// 長時間のTSファイルでNITのバージョンが変わる位置を二分探索で求める
+class Bisect
+{
+public:
+	Bisect(const Config& config);
+	virtual ~Bisect() = default;
+
+	// 先頭と終端のNITを比較し、異なる場合は変化した位置を絞り込んで結果をJSONで返す
+	std::string run();
+
+private:
+	const Config& config_;
+	Probe probe_;
+};
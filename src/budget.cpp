@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "budget.h"
+#include "TSNITSection.h"
+
+Budget::Budget(uint64_t max_bytes, double timeout) :
+	max_bytes_(max_bytes),
+	has_deadline_(timeout > 0)
+{
+	if (has_deadline_)
+	{
+		deadline_ = std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+	}
+}
+
+bool Budget::exhausted(const TS::NITSection& nit)
+{
+	if (max_bytes_ && nit.input_bytes() >= max_bytes_)
+	{
+		reason_ = "--max-bytes reached";
+		return true;
+	}
+
+	if (has_deadline_ && std::chrono::steady_clock::now() >= deadline_)
+	{
+		reason_ = "--timeout reached";
+		return true;
+	}
+
+	return false;
+}
+
+std::string Budget::report(const TS::NITSection& nit) const
+{
+	// 打ち切りまでの進捗を報告
+	std::ostringstream os;
+	os << "read " << nit.input_bytes() << " bytes, "
+		<< "aligned " << nit.sync_packets() << " packets, "
+		<< "seen " << nit.nit_packets() << " NIT packets";
+
+	return report(os.str());
+}
+
+std::string Budget::report(const std::string& progress) const
+{
+	// 入力ごとの進捗に打ち切りの理由を添える
+	if (reason_.empty()) { return progress; }
+	return progress + " (" + reason_ + ')';
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "TSNITSection.h"
+
+// 読み込みバイト数と経過時間による走査の打ち切り
+class Budget
+{
+public:
+	Budget(uint64_t max_bytes, double timeout);
+	virtual ~Budget() = default;
+
+	bool exhausted(const TS::NITSection& nit);
+	std::string report(const TS::NITSection& nit) const;
+	std::string report(const std::string& progress) const;
+
+private:
+	uint64_t max_bytes_ = 0;
+	bool has_deadline_ = false;
+	std::chrono::steady_clock::time_point deadline_;
+	std::string reason_;
+};
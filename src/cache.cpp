@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "TSNITSection.h"
+
+namespace
+{
+	// ファイルの先頭: マジックナンバー、形式の版、入力上の位置、セクションの大きさ
+	constexpr char MAGIC[4] = {'P', '4', 'N', 'C'};
+	constexpr size_t HEADER_SIZE = 4 + 1 + 8 + 4;
+
+	void put_le(std::vector<uint8_t>& buf, uint64_t value, size_t bytes)
+	{
+		for (size_t i = 0; i < bytes; i++)
+		{
+			buf.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	uint64_t get_le(const uint8_t* p, size_t bytes)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < bytes; i++)
+		{
+			value |= static_cast<uint64_t>(p[i]) << (i * 8);
+		}
+		return value;
+	}
+}
+
+Cache::Cache(const std::string& dir) :
+	dir_(dir)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(dir_, ec);
+	if (!std::filesystem::is_directory(dir_))
+	{
+		throw std::runtime_error("failed to create cache directory " + dir_);
+	}
+}
+
+std::string Cache::key(const std::string& input)
+{
+	struct stat st;
+	if (::stat(input.c_str(), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) { return ""; }
+
+#if defined(_WIN32)
+	uint64_t mtime = static_cast<uint64_t>(st.st_mtime);
+#else
+	uint64_t mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+
+	// 先頭のハッシュで同じinodeに書き直されたファイルも区別する
+	std::vector<uint8_t> head(HASH_BYTES);
+	std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(input.c_str(), "rb"), &std::fclose);
+	if (!fp) { return ""; }
+	head.resize(std::fread(head.data(), 1, head.size(), fp.get()));
+
+	std::ostringstream os;
+	os << std::hex << std::setfill('0')
+		<< std::setw(16) << static_cast<uint64_t>(st.st_dev) << '-'
+		<< std::setw(16) << static_cast<uint64_t>(st.st_ino) << '-'
+		<< std::setw(16) << static_cast<uint64_t>(st.st_size) << '-'
+		<< std::setw(16) << mtime << '-'
+		<< std::setw(16) << fnv1a(head.data(), head.size());
+
+	return os.str();
+}
+
+bool Cache::load(const std::string& key, TS::NITSection& nit)
+{
+	std::ifstream ifs(path(key), std::ios::binary);
+	std::vector<uint8_t> buf;
+	if (ifs)
+	{
+		buf.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+
+	// 壊れたエントリは無いものとして扱い、走査結果で上書きする
+	if (buf.size() < HEADER_SIZE
+		|| !std::equal(MAGIC, MAGIC + 4, buf.begin())
+		|| buf[4] != FORMAT_VERSION
+		|| get_le(&buf[13], 4) != buf.size() - HEADER_SIZE
+		|| !nit.push_section(&buf[HEADER_SIZE], buf.size() - HEADER_SIZE, get_le(&buf[5], 8))
+		)
+	{
+		misses_++;
+		return false;
+	}
+
+	hits_++;
+	return true;
+}
+
+void Cache::store(const std::string& key, const TS::NITSection& nit) const
+{
+	auto section = nit.section();
+	if (section.empty()) { return; }
+
+	std::vector<uint8_t> buf(MAGIC, MAGIC + 4);
+	buf.push_back(FORMAT_VERSION);
+	put_le(buf, nit.section_offset(), 8);
+	put_le(buf, section.size(), 4);
+	buf.insert(buf.end(), section.begin(), section.end());
+
+	// 他のプロセスやスレッドが読み込み途中のエントリを壊さないよう一時ファイルから置き換える
+	auto filename = path(key);
+	auto tmp = filename + '.' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream ofs(tmp, std::ios::binary);
+		if (!ofs) { return; }
+		ofs.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+		if (!ofs)
+		{
+			ofs.close();
+			std::remove(tmp.c_str());
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp, filename, ec);
+	if (ec)
+	{
+		std::remove(tmp.c_str());
+	}
+}
+
+bool Cache::remove(const std::string& key) const
+{
+	std::error_code ec;
+	return std::filesystem::remove(path(key), ec);
+}
+
+size_t Cache::clear() const
+{
+	size_t count = 0;
+	std::error_code ec;
+	for (const auto& e : std::filesystem::directory_iterator(dir_, ec))
+	{
+		if (e.path().extension() == EXTENSION && std::filesystem::remove(e.path(), ec))
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+std::string Cache::path(const std::string& key) const
+{
+	return (std::filesystem::path(dir_) / (key + EXTENSION)).string();
+}
+
+uint64_t Cache::fnv1a(const uint8_t* p, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "TSNITSection.h"
+
+// 走査結果(NITセクションと入力上の位置)をファイルの同一性をキーとしてディスクに保存する
+// キーはデバイス、inode、サイズ、更新日時と先頭1MBのFNV-1aハッシュ
+class Cache
+{
+public:
+	Cache(const std::string& dir);
+	virtual ~Cache() = default;
+
+	// 入力が通常ファイルでない場合は空文字列を返す
+	static std::string key(const std::string& input);
+
+	bool load(const std::string& key, TS::NITSection& nit);
+	void store(const std::string& key, const TS::NITSection& nit) const;
+	bool remove(const std::string& key) const;
+	size_t clear() const;
+
+	uint64_t hits() const { return hits_; }
+	uint64_t misses() const { return misses_; }
+
+private:
+	static constexpr size_t HASH_BYTES = 1024 * 1024;
+	static constexpr uint8_t FORMAT_VERSION = 1;
+	static constexpr const char* EXTENSION = ".nit";
+
+	std::string dir_;
+	std::atomic<uint64_t> hits_ = 0;
+	std::atomic<uint64_t> misses_ = 0;
+
+	std::string path(const std::string& key) const;
+	static uint64_t fnv1a(const uint8_t* p, size_t size);
+};
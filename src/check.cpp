@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "check.h"
+#include "TSHeaderBatch.h"
+#include "TSPacket.h"
+
+Check::Check() :
+	last_cc_(PID_COUNT, -1),
+	pid_packets_(PID_COUNT),
+	pid_drops_(PID_COUNT),
+	pid_duplicates_(PID_COUNT)
+{
+}
+
+void Check::push(const TS::Packet& packet, const uint8_t* buf, size_t size)
+{
+	sync_losses_ = packet.sync_losses();
+
+	auto count = size / TS::Packet::size();
+	batch_.decode(buf, count);
+
+	const auto& pids = batch_.pids();
+	const auto& ccs = batch_.continuity_counters();
+	const auto& flags = batch_.flags();
+	for (size_t i = 0; i < count; i++)
+	{
+		packets_++;
+		auto pid = pids[i];
+		pid_packets_[pid]++;
+
+		// TEIが立ったパケットはヘッダも信用できないため連続性を調べない
+		if (flags[i] & TS::HeaderBatch::TRANSPORT_ERROR)
+		{
+			transport_errors_++;
+			continue;
+		}
+
+		// 連続性指標はペイロードを持つパケットのみ増える
+		if (pid == NULL_PID || !(flags[i] & TS::HeaderBatch::PAYLOAD)) { continue; }
+
+		auto cc = static_cast<int8_t>(ccs[i]);
+		auto last = last_cc_[pid];
+		last_cc_[pid] = cc;
+		if (last < 0) { continue; }
+
+		if (cc == last)
+		{
+			pid_duplicates_[pid]++;
+			duplicates_++;
+		}
+		else if (cc != ((last + 1) & 0x0f))
+		{
+			pid_drops_[pid]++;
+			drops_++;
+		}
+	}
+}
+
+std::string Check::report() const
+{
+	std::ostringstream os;
+	os << "check: " << packets_ << " packets, "
+		<< sync_losses_ << " sync losses, "
+		<< transport_errors_ << " TEI, "
+		<< drops_ << " drops, "
+		<< duplicates_ << " duplicates\n";
+
+	for (size_t pid = 0; pid < PID_COUNT; pid++)
+	{
+		if (pid_drops_[pid] == 0 && pid_duplicates_[pid] == 0) { continue; }
+		os << "  pid 0x" << std::hex << std::setw(4) << std::setfill('0') << pid << std::dec
+			<< ": " << pid_packets_[pid] << " packets, "
+			<< pid_drops_[pid] << " drops, "
+			<< pid_duplicates_[pid] << " duplicates\n";
+	}
+
+	return os.str();
+}
+
+nlohmann::json Check::json() const
+{
+	auto j = nlohmann::json::object();
+	j["packets"] = packets_;
+	j["sync_losses"] = sync_losses_;
+	j["transport_errors"] = transport_errors_;
+	j["drops"] = drops_;
+	j["duplicates"] = duplicates_;
+	j["pids"] = nlohmann::json::array();
+	for (size_t pid = 0; pid < PID_COUNT; pid++)
+	{
+		if (pid_drops_[pid] == 0 && pid_duplicates_[pid] == 0) { continue; }
+		j["pids"].push_back({
+			{"pid", pid},
+			{"packets", pid_packets_[pid]},
+			{"drops", pid_drops_[pid]},
+			{"duplicates", pid_duplicates_[pid]},
+		});
+	}
+
+	return j;
+}
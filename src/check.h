@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "TSHeaderBatch.h"
+#include "TSPacket.h"
+
+// 走査と同時に録画の欠損を調べる
+// TEIが立ったパケット、PID毎の連続性指標の抜けと重複、同期外れを数える
+class Check
+{
+public:
+	Check();
+	virtual ~Check() = default;
+
+	// 同期した188バイトのパケット列を渡す
+	void push(const TS::Packet& packet, const uint8_t* buf, size_t size);
+
+	uint64_t packets() const { return packets_; }
+	uint64_t transport_errors() const { return transport_errors_; }
+	uint64_t drops() const { return drops_; }
+	uint64_t duplicates() const { return duplicates_; }
+	uint64_t sync_losses() const { return sync_losses_; }
+
+	std::string report() const;
+	nlohmann::json json() const;
+
+private:
+	static constexpr size_t PID_COUNT = 0x2000;
+	static constexpr uint16_t NULL_PID = 0x1fff;
+
+	TS::HeaderBatch batch_;
+	std::vector<int8_t> last_cc_;
+	std::vector<uint64_t> pid_packets_;
+	std::vector<uint64_t> pid_drops_;
+	std::vector<uint64_t> pid_duplicates_;
+	uint64_t packets_ = 0;
+	uint64_t transport_errors_ = 0;
+	uint64_t drops_ = 0;
+	uint64_t duplicates_ = 0;
+	uint64_t sync_losses_ = 0;
+};
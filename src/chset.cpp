@@ -1,52 +1,90 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
-#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 #include <iostream>
 
 #include "json.hpp"
 #include "chset.h"
 
-void ChSet::init(Satellite kind, int32_t tpnum)
+namespace
 {
-	if (kind == Satellite::BS)
+	// トランスポンダ番号の順の名前、奇数はBS、偶数はCS(ND)
+	constexpr std::array<std::string_view, 24> TRANSPONDER_NAMES{
+		"BS1", "ND2", "BS3", "ND4", "BS5", "ND6",
+		"BS7", "ND8", "BS9", "ND10", "BS11", "ND12",
+		"BS13", "ND14", "BS15", "ND16", "BS17", "ND18",
+		"BS19", "ND20", "BS21", "ND22", "BS23", "ND24",
+	};
+
+	constexpr std::array<Transponder, 24> make_transponders()
 	{
-		if ((tpnum >= 1) && (tpnum <= 23) && ((tpnum % 2) == 1))
+		std::array<Transponder, 24> t{};
+		for (int32_t tpnum = 1; tpnum <= 24; tpnum++)
 		{
-			// BS
-			std::ostringstream os;
-			os << "BS" << tpnum;
-			transponder_ = os.str();
-			number_ = tpnum;
-			frequency_idx_ = (tpnum - 1) / 2;
-			frequency_khz_ = 11727480 + frequency_idx_ * 38360;
-			has_lock_ = false;
+			auto& e = t[tpnum - 1];
+			e.name = TRANSPONDER_NAMES[tpnum - 1];
+			e.number = tpnum;
+			if (tpnum % 2 == 1)
+			{
+				e.frequency_idx = (tpnum - 1) / 2;
+				e.frequency_khz = 11727480 + e.frequency_idx * 38360;
+			}
+			else
+			{
+				e.frequency_idx = (tpnum - 2) / 2 + 12;
+				e.frequency_khz = 12291000 + (e.frequency_idx - 12) * 40000;
+			}
 		}
+		return t;
 	}
-	else
+
+	constexpr auto TRANSPONDERS = make_transponders();
+	static_assert(TRANSPONDERS[22].frequency_khz == 12149440, "BS23");
+	static_assert(TRANSPONDERS[23].frequency_khz == 12731000, "ND24");
+
+	// TSIDが並んでいる位置、見つからない場合は-1
+	int32_t relative_ts_number(const ChSet& c, uint16_t tsid)
 	{
-		if ((tpnum >= 2) && (tpnum <= 24) && ((tpnum % 2) == 0))
-		{
-			// CS
-			std::ostringstream os;
-			os << "ND" << tpnum;
-			transponder_ = os.str();
-			number_ = tpnum;
-			frequency_idx_ = (tpnum - 2) / 2 + 12;
-			frequency_khz_ = 12291000 + (frequency_idx_ - 12) * 40000;
-			has_lock_ = false;
-		}
+		const auto& tsids = c.transport_stream_id();
+		auto pos = std::find(tsids.begin(), tsids.end(), tsid);
+
+		return pos == tsids.end() ? -1 : static_cast<int32_t>(std::distance(tsids.begin(), pos));
 	}
 }
 
-bool ChSet::set_transport_stream_id(uint16_t tsid)
+const Transponder* ChSet::find_transponder(int32_t tpnum)
 {
-	if (transport_stream_id_.size() == 0)
+	if (tpnum < 1 || tpnum > static_cast<int32_t>(TRANSPONDERS.size()))
 	{
-		transport_stream_id_.resize(8, 0xffff);
+		return nullptr;
 	}
 
+	return &TRANSPONDERS[tpnum - 1];
+}
+
+void ChSet::init(Satellite kind, int32_t tpnum)
+{
+	auto t = find_transponder(tpnum);
+	if (!t) { return; }
+
+	// BSは奇数、CSは偶数のトランスポンダ番号のみ
+	if ((kind == Satellite::BS) != (tpnum % 2 == 1)) { return; }
+
+	transponder_ = t->name;
+	number_ = t->number;
+	frequency_idx_ = t->frequency_idx;
+	frequency_khz_ = t->frequency_khz;
+	has_lock_ = false;
+}
+
+bool ChSet::set_transport_stream_id(uint16_t tsid)
+{
 	if (tsid == 0 || tsid == 0xffff)
 	{
 		return false;
@@ -64,17 +102,13 @@ bool ChSet::set_transport_stream_id(uint16_t tsid)
 
 	auto tsnum = (tsid & 0x07);
 	transport_stream_id_.at(tsnum) = tsid;
-	auto result = std::find(transport_stream_id_.begin(), transport_stream_id_.end(), tsid);
-	if (result == transport_stream_id_.end())
-	{
-		transport_stream_id_.at(tsnum) = tsid;
-	}
 
 	return true;
 }
 
 void ChSet::sort_relative_ts_number(int32_t method)
 {
+	// 並べ替えは固定長の配列の中で行い、領域を確保しない
 	switch (method)
 	{
 	case 1:
@@ -83,9 +117,8 @@ void ChSet::sort_relative_ts_number(int32_t method)
 		// NITから得られる情報ではTMCC内の相対TS番号がわからないため、有効なTSIDがゼロから始まる様に並べ替える。
 		// 並べ替え前：[0xffff, 0x40f1, 0x40f2, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff]
 		// 並べ替え後：[0x40f1, 0x40f2, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff]
-		auto tsids = transport_stream_id_;
-		auto result = std::find_if(tsids.begin(), tsids.end(), [](uint16_t x) { return x != 0xffff; });
-		if (result == tsids.begin() || result == tsids.end())
+		auto result = std::find_if(transport_stream_id_.begin(), transport_stream_id_.end(), [](uint16_t x) { return x != 0xffff; });
+		if (result == transport_stream_id_.begin() || result == transport_stream_id_.end())
 		{
 			// TSIDの相対TS番号がゼロから始まる場合、有効なTSIDが存在しない場合は何もしない。
 			// [0x40f1, 0x40f2, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff]
@@ -97,8 +130,8 @@ void ChSet::sort_relative_ts_number(int32_t method)
 			// 有効なTSID間に無効なTSIDがある場合は間を詰めずそのままずらす。
 			// 並べ替え前：[0xffff, 0x40f1, 0xffff, 0x40f3, 0xffff, 0xffff, 0xffff, 0xffff]
 			// 並べ替え後：[0x40f1, 0xffff, 0x40f3, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff]
-			std::fill(transport_stream_id_.begin(), transport_stream_id_.end(), 0xffff);
-			std::copy(result, tsids.end(), transport_stream_id_.begin());
+			auto last = std::copy(result, transport_stream_id_.end(), transport_stream_id_.begin());
+			std::fill(last, transport_stream_id_.end(), 0xffff);
 		}
 		break;
 	}
@@ -108,16 +141,8 @@ void ChSet::sort_relative_ts_number(int32_t method)
 		// NITから得られる情報ではTMCC内の相対TS番号がわからないため、有効なTSIDがゼロから始まる様に並べ替える。
 		// 並べ替え前：[0xffff, 0x40f1, 0xffff, 0x40f3, 0xffff, 0xffff, 0xffff, 0xffff]
 		// 並べ替え後：[0x40f1, 0x40f3, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff]
-		std::vector<uint16_t> tsids;
-		for (auto tsid : transport_stream_id_)
-		{
-			if (tsid != 0xffff)
-			{
-				tsids.emplace_back(tsid);
-			}
-		}
-		tsids.resize(transport_stream_id_.size(), 0xffff);
-		transport_stream_id_ = tsids;
+		auto last = std::remove(transport_stream_id_.begin(), transport_stream_id_.end(), 0xffff);
+		std::fill(last, transport_stream_id_.end(), 0xffff);
 		break;
 	}
 	default:
@@ -125,7 +150,7 @@ void ChSet::sort_relative_ts_number(int32_t method)
 		// TSIDの下位3ビットから求まる値をTMCC内の相対TS番号として設定。
 		// BS15の例外があるため、相対TS番号に意味がある場合は使用しない。
 		auto tsids = transport_stream_id_;
-		std::fill(transport_stream_id_.begin(), transport_stream_id_.end(), 0xffff);
+		transport_stream_id_.fill(0xffff);
 		for (auto tsid : tsids)
 		{
 			auto tsnum = (tsid & 0x07);
@@ -137,18 +162,66 @@ void ChSet::sort_relative_ts_number(int32_t method)
 
 void ChSet::set_from_json(const nlohmann::json& j)
 {
-	transponder_ = j.at("transponder").get<std::string>();
+	// 名前は固定情報の表から探す
+	auto name = j.at("transponder").get<std::string>();
+	const Transponder* t = nullptr;
+	for (const auto& e : TRANSPONDERS)
+	{
+		if (e.name == name) { t = &e; }
+	}
+	if (!t)
+	{
+		throw std::runtime_error("unknown transponder " + name);
+	}
+
+	transponder_ = t->name;
 	number_ = j.at("number").get<int32_t>();
 	frequency_idx_ = j.at("frequency_idx").get<int32_t>();
 	frequency_khz_ = j.at("frequency_khz").get<uint32_t>();
 	has_lock_ =  j.at("has_lock").get<bool>();
-	transport_stream_id_ = j.at("transport_stream_id").get<std::vector<uint16_t>>();
+	transport_stream_id_.fill(0xffff);
+	const auto& tsids = j.at("transport_stream_id");
+	for (size_t tsnum = 0; tsnum < std::min(tsids.size(), TS_COUNT); tsnum++)
+	{
+		transport_stream_id_[tsnum] = tsids.at(tsnum).get<uint16_t>();
+	}
 }
 
 
+bool ServiceIndex::insert(const Entry& entry)
+{
+	auto last = entries_.begin() + size_;
+	auto it = std::lower_bound(entries_.begin(), last, entry.service_id,
+		[](const Entry& e, uint16_t id) { return e.service_id < id; });
+	if (it != last && it->service_id == entry.service_id)
+	{
+		*it = entry;
+		return true;
+	}
+	if (size_ == entries_.size())
+	{
+		return false;
+	}
+
+	std::copy_backward(it, last, last + 1);
+	*it = entry;
+	size_++;
+
+	return true;
+}
+
+const ServiceIndex::Entry* ServiceIndex::find(uint16_t service_id) const
+{
+	auto last = entries_.begin() + size_;
+	auto it = std::lower_bound(entries_.begin(), last, service_id,
+		[](const Entry& e, uint16_t id) { return e.service_id < id; });
+
+	return (it != last && it->service_id == service_id) ? &*it : nullptr;
+}
+
 void ChSets::init()
 {
-	static const std::vector<uint16_t> TSIDS_CS{
+	static constexpr std::array<uint16_t, 12> TSIDS_CS{
 		0x6020,
 		0x7040,
 		0x7060,
@@ -188,8 +261,12 @@ void ChSets::init()
 
 void ChSets::clear()
 {
-	chsets_bs_.clear();
-	chsets_cs_.clear();
+	// 固定長のため初期状態へ戻す
+	chsets_bs_.fill(ChSet());
+	chsets_cs_.fill(ChSet());
+	services_.clear();
+	network_.clear();
+	init();
 }
 
 bool ChSets::set_transport_stream_id(uint16_t tsid)
@@ -225,12 +302,66 @@ bool ChSets::set_transport_stream_id(uint16_t tsid)
 	return true;
 }
 
+bool ChSets::add_service(uint16_t service_id, uint16_t network_id, uint16_t tsid, uint8_t service_type)
+{
+	ServiceIndex::Entry entry;
+	entry.service_id = service_id;
+	entry.network_id = network_id;
+	entry.transport_stream_id = tsid;
+	entry.service_type = service_type;
+
+	auto c = is_satellite(network_id) ? find(tsid) : nullptr;
+	if (c)
+	{
+		entry.transponder = c->number();
+		entry.frequency_khz = c->frequency_khz();
+		entry.relative_ts_number = relative_ts_number(*c, tsid);
+	}
+	else
+	{
+		auto t = network_.find_tsid(network_id, tsid);
+		if (!t)
+		{
+			return false;
+		}
+		entry.frequency_khz = t->frequency_khz;
+		auto last = t->transport_stream_id.begin() + t->ts_count;
+		entry.relative_ts_number = static_cast<int32_t>(std::distance(t->transport_stream_id.begin(), std::find(t->transport_stream_id.begin(), last, tsid)));
+	}
+
+	return services_.insert(entry);
+}
+
 void ChSets::sort_relative_ts_number(int32_t method)
 {
 	for (auto& c : chsets_bs_)
 	{
 		c.sort_relative_ts_number(method);
 	}
+	update_services();
+}
+
+const ChSet* ChSets::find(uint16_t tsid) const
+{
+	auto tpnum = (tsid & 0x01f0) >> 4;
+	if (tsid == 0 || tsid == 0xffff || tpnum < 1 || tpnum > 24)
+	{
+		return nullptr;
+	}
+
+	return (tpnum % 2 != 0) ? &chsets_bs_.at((tpnum - 1) / 2) : &chsets_cs_.at((tpnum - 2) / 2);
+}
+
+void ChSets::update_services()
+{
+	// 並べ替えでTSIDの位置が変わるため相対TS番号を求め直す
+	for (auto& e : services_)
+	{
+		if (e.transponder == 0) { continue; }
+		auto c = find(e.transport_stream_id);
+		if (!c) { continue; }
+		e.relative_ts_number = relative_ts_number(*c, e.transport_stream_id);
+	}
 }
 
 nlohmann::json ChSets::json() const
@@ -249,13 +380,21 @@ nlohmann::json ChSets::json() const
 		j.at("CS").emplace_back(p);
 	}
 
+	j["transponders"] = network_.json();
+
+	j["services"] = nlohmann::json::array();
+	for (const auto& p : services_)
+	{
+		j.at("services").emplace_back(p);
+	}
+
 	return j;
 }
 
 void to_json(nlohmann::json& j, const ChSet& p)
 {
 	j = nlohmann::json{
-		{"transponder", p.transponder()},
+		{"transponder", std::string(p.transponder())},
 		{"number", p.number()},
 		{"frequency_idx", p.frequency_idx()},
 		{"frequency_khz", p.frequency_khz()},
@@ -270,3 +409,16 @@ void from_json(const nlohmann::json& j, ChSet& p)
 	p.set_from_json(j);
 }
 
+void to_json(nlohmann::json& j, const ServiceIndex::Entry& p)
+{
+	auto t = ChSet::find_transponder(p.transponder);
+	j = nlohmann::json{
+		{"service_id", p.service_id},
+		{"service_type", p.service_type},
+		{"network_id", p.network_id},
+		{"transport_stream_id", p.transport_stream_id},
+		{"transponder", t ? std::string(t->name) : std::string()},
+		{"frequency_khz", p.frequency_khz},
+		{"relative_ts_number", p.relative_ts_number},
+	};
+}
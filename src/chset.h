@@ -2,22 +2,38 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 
-#include <string>
-#include <vector>
+#include <string_view>
 
 #include "json.hpp"
 
+#include "network.h"
+
+// BS/CSのトランスポンダの固定情報
+struct Transponder
+{
+	std::string_view name;
+	int32_t number = 0;
+	int32_t frequency_idx = 0;
+	uint32_t frequency_khz = 0;
+};
+
 class ChSet
 {
 public:
+	// TMCC内の相対TS番号の数
+	static constexpr size_t TS_COUNT = 8;
+	using TransportStreamIds = std::array<uint16_t, TS_COUNT>;
+
 	ChSet() :
 		number_(0),
 		frequency_idx_(0),
-		frequency_khz_(0),
-		transport_stream_id_(8, 0xffff)
-	{}
+		frequency_khz_(0)
+	{
+		transport_stream_id_.fill(0xffff);
+	}
 	virtual ~ChSet() = default;
 
 	enum class Satellite
@@ -26,13 +42,13 @@ public:
 		CS
 	};
 
-	const std::string& transponder() const { return transponder_; }
+	std::string_view transponder() const { return transponder_; }
 	int32_t number() const { return number_; }
 	int32_t frequency_idx() const { return frequency_idx_; }
 	uint32_t frequency_khz() const { return frequency_khz_; }
 	uint32_t frequency_if_khz() const { return frequency_khz_ - 10678000; }
 	bool has_lock() const { return has_lock_; }
-	const std::vector<uint16_t>& transport_stream_id() const { return transport_stream_id_; }
+	const TransportStreamIds& transport_stream_id() const { return transport_stream_id_; }
 	uint16_t transport_stream_id(size_t tsnum) const { return transport_stream_id_.at(tsnum); }
 
 	void init(Satellite kind, int32_t idx);
@@ -40,21 +56,67 @@ public:
 	void sort_relative_ts_number(int32_t method);
 	void set_from_json(const nlohmann::json& j);
 
+	// トランスポンダ番号(BS1からND24)の固定情報、範囲外の場合はnullptr
+	static const Transponder* find_transponder(int32_t tpnum);
+
 protected:
-	std::string transponder_;
+	// 名前は固定情報の表を指す
+	std::string_view transponder_;
 	int32_t number_ = 0;
 	int32_t frequency_idx_ = 0;
 	uint32_t frequency_khz_ = 0;
 	bool has_lock_ = false;
-	std::vector<uint16_t> transport_stream_id_;
+	TransportStreamIds transport_stream_id_;
+};
+
+// service_idの昇順に並べた固定長の索引
+class ServiceIndex
+{
+public:
+	// 1つのNITに載るサービスの上限
+	static constexpr size_t MAX_SERVICES = 256;
+
+	struct Entry
+	{
+		uint16_t service_id = 0;
+		uint16_t network_id = 0;
+		uint16_t transport_stream_id = 0xffff;
+		uint8_t service_type = 0;
+		// トランスポンダ番号(BS1からND24)、固定の配置にない場合は0
+		int32_t transponder = 0;
+		uint32_t frequency_khz = 0;
+		// TMCC内の相対TS番号、並べ替え後の位置
+		// 固定の配置にない場合はトランスポンダの一覧に現れた順
+		int32_t relative_ts_number = -1;
+	};
+
+	ServiceIndex() = default;
+	~ServiceIndex() = default;
+
+	const Entry* begin() const { return entries_.data(); }
+	const Entry* end() const { return entries_.data() + size_; }
+	Entry* begin() { return entries_.data(); }
+	Entry* end() { return entries_.data() + size_; }
+	size_t size() const { return size_; }
+
+	void clear() { size_ = 0; }
+	// 同じservice_idは置き換え、上限を超える場合はfalse
+	bool insert(const Entry& entry);
+	const Entry* find(uint16_t service_id) const;
+
+private:
+	std::array<Entry, MAX_SERVICES> entries_;
+	size_t size_ = 0;
 };
 
 class ChSets
 {
 public:
-	ChSets() :
-		chsets_bs_(12),
-		chsets_cs_(12)
+	// BSとCSのトランスポンダの数
+	static constexpr size_t TRANSPONDER_COUNT = 12;
+	using ChSetArray = std::array<ChSet, TRANSPONDER_COUNT>;
+
+	ChSets()
 	{
 		init();
 	}
@@ -62,17 +124,33 @@ public:
 
 	void clear();
 	bool set_transport_stream_id(uint16_t tsid);
+	// TSIDとトランスポンダの一覧を設定した後にそのTSのサービスを加える
+	// 固定の配置にないTSIDはトランスポンダの一覧から探す
+	bool add_service(uint16_t service_id, uint16_t network_id, uint16_t tsid, uint8_t service_type);
+	// 固定の配置によらない(network_id, 周波数)毎のトランスポンダ
+	Network& network() { return network_; }
+	const Network& network() const { return network_; }
 	void sort_relative_ts_number(int32_t method);
 	nlohmann::json json() const;
-	const std::vector<ChSet>& bs() const { return chsets_bs_; };
-	const std::vector<ChSet>& cs() const { return chsets_cs_; };
+	const ChSetArray& bs() const { return chsets_bs_; };
+	const ChSetArray& cs() const { return chsets_cs_; };
+	const ServiceIndex& services() const { return services_; }
+	const ServiceIndex::Entry* find_service(uint16_t service_id) const { return services_.find(service_id); }
+
+	// BS1からND24の固定の配置に当てはめるnetwork_id(BS、CS1、CS2)
+	static bool is_satellite(uint16_t network_id) { return network_id == 0x0004 || network_id == 0x0006 || network_id == 0x0007; }
 
 private:
-	std::vector<ChSet> chsets_bs_;
-	std::vector<ChSet> chsets_cs_;
+	ChSetArray chsets_bs_;
+	ChSetArray chsets_cs_;
+	ServiceIndex services_;
+	Network network_;
 
 	void init();
+	const ChSet* find(uint16_t tsid) const;
+	void update_services();
 };
 
 void to_json(nlohmann::json& j, const ChSet& p);
 void from_json(const nlohmann::json& j, ChSet& p);
+void to_json(nlohmann::json& j, const ServiceIndex::Entry& p);
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "budget.h"
+#include "classify.h"
+#include "input.h"
+#include "TSNITSection.h"
+
+int32_t Classify::run()
+{
+	TS::NITSection nit;
+	std::vector<uint8_t> buf(READ_SIZE);
+
+	size_t failed = 0;
+	auto j = nlohmann::json::array();
+	for (const auto& input : config_.inputs())
+	{
+		Result result;
+		result.input = input;
+		classify(result, nit, buf);
+
+		auto f = nlohmann::json::object();
+		f["input"] = result.input;
+		f["ok"] = result.ok;
+		if (result.ok)
+		{
+			f["network_id"] = result.network_id;
+			f["network"] = network_name(result.network_id);
+			f["version"] = result.version_number;
+			f["offset"] = result.offset;
+		}
+		else
+		{
+			f["error"] = result.error;
+			failed++;
+		}
+		f["bytes"] = result.input_bytes;
+		j.push_back(f);
+	}
+
+	auto data = j.dump(4) + '\n';
+	std::fwrite(data.c_str(), data.size(), 1, stdout);
+
+	return failed ? 1 : 0;
+}
+
+std::string Classify::network_name(uint16_t network_id)
+{
+	// ARIB TR-B14/B15のnetwork_idの割り当て
+	if (network_id == 0x0004) { return "BS"; }
+	if (network_id == 0x0006) { return "CS1"; }
+	if (network_id == 0x0007) { return "CS2"; }
+	if (network_id >= 0x7880 && network_id <= 0x7fe8) { return "terrestrial"; }
+
+	return "unknown";
+}
+
+void Classify::classify(Result& result, TS::NITSection& nit, std::vector<uint8_t>& buf) const
+{
+	nit.reset();
+
+	// NITSectionは同期のみに使い、セクションは組み立てない
+	// 同期したパケットをハンドラで調べ、見つかった時点で読み込みを止める
+	nit.set_packet_handler([&result](const TS::NITSection& packet, const uint8_t* p, size_t size) {
+		if (!result.ok) { find(result, packet, p, size); }
+	});
+	nit.set_sync_only(true);
+
+	try
+	{
+		std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(result.input.c_str(), "rb"), &std::fclose);
+		if (!fp)
+		{
+			throw std::runtime_error("failed to open " + result.input);
+		}
+
+		Budget budget(config_.max_bytes(), config_.timeout());
+		auto in = Input::open_file(fp.get(), buf);
+		in->set_max_bytes(config_.max_bytes());
+		in->drain(nit, budget, [&result] { return result.ok; });
+
+		if (!result.ok)
+		{
+			result.error = "NIT packets not found";
+		}
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	nit.set_packet_handler(nullptr);
+	nit.set_sync_only(false);
+	result.input_bytes = nit.input_bytes();
+}
+
+bool Classify::find(Result& result, const TS::NITSection& nit, const uint8_t* buf, size_t size)
+{
+	// 自ネットワークのNITのセクションの先頭を運ぶパケットのヘッダのみ調べる
+	TS::NITHeader header;
+	for (size_t pos = 0; pos + TS::Packet::size() <= size; pos += TS::Packet::size())
+	{
+		const auto* p = buf + pos;
+		if (!header.parse_nit_header(p)) { continue; }
+		if (!header.payload_start_indicator() || header.table_id() != 0x40 || !header.current_next_indicator()) { continue; }
+
+		result.ok = true;
+		result.network_id = header.network_id();
+		result.version_number = header.version_number();
+		result.offset = nit.input_offset(pos);
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "TSNITSection.h"
+
+// 多数の入力を最初に現れたNITのヘッダのみで分類する
+// セクションは組み立てず、少しずつ読み込んでヘッダが見つかった時点で次の入力へ進む
+class Classify
+{
+public:
+	Classify(const Config& config) : config_(config) {}
+	virtual ~Classify() = default;
+
+	// 入力毎のnetwork_idとバージョンをJSONで標準出力へ出力する
+	int32_t run();
+
+	static std::string network_name(uint16_t network_id);
+
+private:
+	// 1回に読み込むバイト数
+	static constexpr size_t READ_SIZE = 16 * 1024;
+
+	struct Result
+	{
+		std::string input;
+		std::string error;
+		bool ok = false;
+		uint16_t network_id = 0;
+		uint8_t version_number = 0xff;
+		uint64_t offset = 0;
+		uint64_t input_bytes = 0;
+	};
+
+	const Config& config_;
+
+	void classify(Result& result, TS::NITSection& nit, std::vector<uint8_t>& buf) const;
+	static bool find(Result& result, const TS::NITSection& nit, const uint8_t* buf, size_t size);
+};
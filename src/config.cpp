@@ -3,17 +3,25 @@
 #include <getopt.h>
 
 #include <cstdio>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <string>
 #include <stdexcept>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #if defined(_WIN32)
 #include <fcntl.h>
 #include <io.h>
+#else
+#include <glob.h>
 #endif
 
 #include "convert.h"
 #include "config.h"
+#include "input.h"
 
 Config::~Config()
 {
@@ -26,13 +34,37 @@ void Config::parse(int argc, char* argv[])
 		{"help", no_argument, 0, 'h'},
 		{"format", required_argument, 0, 'f'},
 		{"sorting", required_argument, 0, 's'},
+		{"multi", no_argument, 0, 'm'},
+		{"output-dir", required_argument, 0, 'o'},
+		{"max-bytes", required_argument, 0, 'B'},
+		{"timeout", required_argument, 0, 'T'},
+		{"parallel", required_argument, 0, 'P'},
+		{"jobs", required_argument, 0, 'j'},
+		{"sequential", no_argument, 0, 'S'},
+		{"probe", required_argument, 0, 'p'},
+		{"probe-window", required_argument, 0, 'W'},
+		{"bisect", no_argument, 0, 'b'},
+		{"cache-dir", required_argument, 0, 'C'},
+		{"cache-clear", no_argument, 0, 'X'},
+		{"index", no_argument, 0, 'I'},
+		{"use-index", optional_argument, 0, 'U'},
+		{"extract-nit", required_argument, 0, 'E'},
+		{"follow", no_argument, 0, 'F'},
+		{"checkpoint", required_argument, 0, 'K'},
+		{"watch", no_argument, 0, 'w'},
+		{"sections", no_argument, 0, 'x'},
+		{"check", no_argument, 0, 'c'},
+		{"profile", optional_argument, 0, 'R'},
+		{"nit-interval", no_argument, 0, 'N'},
+		{"classify", no_argument, 0, 'y'},
+		{"service", required_argument, 0, 'V'},
 		{0,0,0,0},
 	};
 
 	while(true)
 	{
 		auto option_index = 0;
-		auto c = getopt_long(argc, argv, "hf:s:", long_options, &option_index);
+		auto c = getopt_long(argc, argv, "hf:s:mo:B:T:P:j:Sp:W:bC:XIU::E:FK:wxcR::NyV:", long_options, &option_index);
 		if (c == -1) { break; }
 
 		switch (c)
@@ -47,6 +79,139 @@ void Config::parse(int argc, char* argv[])
 			sorting_ = std::stoi(optarg);
 			break;
 		}
+		case 'm':
+		{
+			multi_ = true;
+			break;
+		}
+		case 'o':
+		{
+			output_dir_ = optarg;
+			break;
+		}
+		case 'B':
+		{
+			max_bytes_ = std::stoull(optarg);
+			break;
+		}
+		case 'T':
+		{
+			timeout_ = std::stod(optarg);
+			break;
+		}
+		case 'P':
+		{
+			parallel_ = std::stoi(optarg);
+			break;
+		}
+		case 'j':
+		{
+			jobs_ = std::stoi(optarg);
+			if (jobs_ <= 0)
+			{
+				jobs_ = std::max(1u, std::thread::hardware_concurrency());
+			}
+			break;
+		}
+		case 'S':
+		{
+			// 1ファイルずつ順に読み込み、次のファイルを先読みする
+			sequential_ = true;
+			break;
+		}
+		case 'p':
+		{
+			probe_ = std::stoi(optarg);
+			break;
+		}
+		case 'W':
+		{
+			probe_window_ = std::stoull(optarg);
+			break;
+		}
+		case 'b':
+		{
+			bisect_ = true;
+			break;
+		}
+		case 'C':
+		{
+			cache_dir_ = optarg;
+			break;
+		}
+		case 'X':
+		{
+			cache_clear_ = true;
+			break;
+		}
+		case 'I':
+		{
+			index_ = true;
+			break;
+		}
+		case 'U':
+		{
+			use_index_ = true;
+			index_file_ = optarg ? optarg : "";
+			break;
+		}
+		case 'E':
+		{
+			extract_nit_ = optarg;
+			break;
+		}
+		case 'F':
+		{
+			follow_ = true;
+			break;
+		}
+		case 'K':
+		{
+			checkpoint_ = optarg;
+			break;
+		}
+		case 'w':
+		{
+			watch_ = true;
+			break;
+		}
+		case 'x':
+		{
+			sections_ = true;
+			break;
+		}
+		case 'c':
+		{
+			check_ = true;
+			break;
+		}
+		case 'R':
+		{
+			profile_ = true;
+			profile_output_ = optarg ? optarg : "";
+			break;
+		}
+		case 'N':
+		{
+			nit_interval_ = true;
+			break;
+		}
+		case 'y':
+		{
+			classify_ = true;
+			break;
+		}
+		case 'V':
+		{
+			// 10進数または0x付きの16進数
+			service_ = std::stoi(optarg, nullptr, 0);
+			if (service_ < 0 || service_ > 0xffff)
+			{
+				error_ = usage(argv[0], "invalid service_id");
+				throw std::runtime_error(error_);
+			}
+			break;
+		}
 		case 'h':
 		default:
 			error_ = usage(argv[0]);
@@ -54,22 +219,121 @@ void Config::parse(int argc, char* argv[])
 		}
 	}
 
-	if (!Convert::has_format(format_))
+	// 一括処理と監視ではカンマ区切りで複数の形式を出力できる
+	std::istringstream formats(format_);
+	for (std::string f; std::getline(formats, f, ',');)
+	{
+		if (!Convert::has_format(f))
+		{
+			error_ = usage(argv[0], "unknown format");
+			throw std::runtime_error(error_);
+		}
+		formats_.emplace_back(f);
+	}
+	if (formats_.empty())
 	{
 		error_ = usage(argv[0], "unknown format");
 		throw std::runtime_error(error_);
 	}
+	if (formats_.size() > 1 && !jobs_ && !sequential_ && !watch_)
+	{
+		error_ = usage(argv[0], "multiple formats require --jobs, --sequential or --watch");
+		throw std::runtime_error(error_);
+	}
+	format_ = formats_.front();
 
-	if (sorting_ == 0 && Convert::has_relative_ts_number(format_))
+	// 検査と集計は入力全体を先頭から順に読む場合のみ
+	if (full_scan() && (probe_ > 0 || parallel_ > 1 || bisect_ || index_ || use_index_ || follow_ || !checkpoint_.empty() || sections_ || multi_))
 	{
-		sorting_ = 2;
+		error_ = usage(argv[0], "--check and --profile cannot be combined with --probe, --parallel, --bisect, --index, --use-index, --follow, --checkpoint, --sections or --multi");
+		throw std::runtime_error(error_);
 	}
 
+	sorting_option_ = sorting_;
+	sorting_ = sorting(format_);
+
 	argc -= optind;
+	if (watch_)
+	{
+		// 監視するディレクトリに新しく書き込まれたファイルをjobs個のスレッドで処理する
+		if (argc < 1)
+		{
+			error_ = usage(argv[0], "invalid number of arguments");
+			throw std::runtime_error(error_);
+		}
+		if (jobs_ <= 0)
+		{
+			jobs_ = 1;
+		}
+		inputs_.assign(argv + optind, argv + optind + argc);
+		return;
+	}
+
+	if (classify_)
+	{
+		// 一括処理と同じく展開した全ての入力を分類し、結果は標準出力へ出力する
+		expand_inputs(std::vector<std::string>(argv + optind, argv + optind + argc));
+		if (inputs_.empty())
+		{
+			error_ = usage(argv[0], "no input files");
+			throw std::runtime_error(error_);
+		}
+		return;
+	}
+
+	if (cache_clear_)
+	{
+		// 入力を指定した場合はその入力のエントリのみ、省略した場合は全てのエントリを削除
+		if (cache_dir_.empty())
+		{
+			error_ = usage(argv[0], "--cache-clear requires --cache-dir");
+			throw std::runtime_error(error_);
+		}
+		inputs_.assign(argv + optind, argv + optind + argc);
+		return;
+	}
+
+	if (sequential_)
+	{
+		jobs_ = 1;
+	}
+	if (jobs_)
+	{
+		// 一括処理の場合はディレクトリ、ワイルドカード、@リストファイルを展開
+		expand_inputs(std::vector<std::string>(argv + optind, argv + optind + argc));
+		if (inputs_.empty())
+		{
+			error_ = usage(argv[0], "no input files");
+			throw std::runtime_error(error_);
+		}
+		return;
+	}
+
+	if (multi_)
+	{
+		// 複数入力の場合は全て入力とし、出力はoutput_dirへ入力毎に行う
+		if (argc < 1)
+		{
+			error_ = usage(argv[0], "invalid number of arguments");
+			throw std::runtime_error(error_);
+		}
+		inputs_.assign(argv + optind, argv + optind + argc);
+		return;
+	}
+
 	if (argc == 1)
 	{
 		input_ = argv[optind];
 		output_ = Convert::get_filename(format_);
+		if (index_)
+		{
+			// 索引は入力の隣に出力する
+			output_ = input_ == "-" ? input_ : input_ + ".nitidx";
+		}
+		if (bisect_ || nit_interval_ || service_ >= 0)
+		{
+			output_ = "-";
+		}
 	}
 	else if (argc == 2)
 	{
@@ -82,9 +346,31 @@ void Config::parse(int argc, char* argv[])
 		throw std::runtime_error(error_);
 	}
 
+	if (use_index_ && index_file_.empty())
+	{
+		index_file_ = input_ + ".nitidx";
+	}
+
+	if (profile_ && profile_output_.empty())
+	{
+		// 集計は入力の隣に出力する
+		profile_output_ = (input_ == "-" || Input::is_stream(input_)) ? "profile.json" : input_ + ".profile.json";
+	}
+
 	open_file();
 }
 
+int32_t Config::sorting(const std::string& format) const
+{
+	// 並び替えを指定しない場合は形式の既定値
+	if (sorting_option_ == 0 && Convert::has_relative_ts_number(format))
+	{
+		return 2;
+	}
+
+	return sorting_option_;
+}
+
 std::string Config::usage(const std::string& argv0, const std::string& msg) const
 {
 	std::ostringstream os;
@@ -92,12 +378,56 @@ std::string Config::usage(const std::string& argv0, const std::string& msg) cons
 	os << "\n"
 		<< "usage: " << argv0
 		<< " [options] input [output]\n"
+		<< "       " << argv0 << " [options] --multi input...\n"
+		<< "       " << argv0 << " [options] --jobs=int input...\n"
+		<< "       " << argv0 << " [options] --sequential input...\n"
+		<< "       " << argv0 << " [options] --watch directory...\n"
+		<< "       " << argv0 << " --cache-dir=dir --cache-clear [input...]\n"
 		<< "\n"
 		<< "options:\n"
 		<< "  --help          show this help message\n"
 		<< "  --format=str    output format (json,dvbv5,dvbv5lnb,mirakurun,bondvb,bonpt,bonptx,bonpx4,bonpx3,bonbda,bonplexpx)\n"
+		<< "                  comma separated list for --jobs, --sequential and --watch\n"
 		<< "  --sorting=int   sorting method (1, 2)\n"
-		<< "  input           input filename, '-': stdin\n"
+		<< "  --multi         monitor all inputs (files, FIFOs, udp/rtp) in one process\n"
+		<< "  --output-dir=s  output directory for --multi, --jobs and --watch (default '.')\n"
+		<< "  --max-bytes=int stop scanning after reading this many bytes\n"
+		<< "  --timeout=sec   stop scanning after this many seconds\n"
+		<< "  --parallel=int  scan a single input file with this many threads\n"
+		<< "  --probe=int     read this many windows at spaced offsets of a large input file\n"
+		<< "  --probe-window=int\n"
+		<< "                  bytes per probe window (default 64MiB)\n"
+		<< "  --bisect        find the offset where the NIT version changes in a large input file\n"
+		<< "                  and output both lineups as JSON\n"
+		<< "  --cache-dir=s   reuse scan results of unchanged input files stored in this directory\n"
+		<< "  --cache-clear   remove cached results of the given inputs, or all without inputs\n"
+		<< "  --index         write offsets, versions and CRCs of all NIT sections in the input\n"
+		<< "                  (default output: input.nitidx)\n"
+		<< "  --use-index[=s] read only the NIT packets listed in an index written by --index\n"
+		<< "                  instead of scanning, and scan if it does not match (default: input.nitidx)\n"
+		<< "  --extract-nit=s also write the TS packets of the NIT to this file, which can be\n"
+		<< "                  used as an input later\n"
+		<< "  --follow        keep reading a file being written until the NIT is complete\n"
+		<< "  --checkpoint=s  save the scan state of an incomplete file to this file and\n"
+		<< "                  resume from it on the next run\n"
+		<< "  --watch         watch directories and scan each new file with --jobs threads\n"
+		<< "  --sections      the input is a dump of NIT sections with CRC instead of TS\n"
+		<< "  --check         read the whole input and report TEI packets, continuity counter\n"
+		<< "                  drops and duplicates per PID, and sync losses\n"
+		<< "  --profile[=s]   read the whole input and write packets and bitrates per PID and\n"
+		<< "                  per service with the PCR based duration as JSON\n"
+		<< "                  (default: input.profile.json, output-dir/label_profile.json)\n"
+		<< "  --nit-interval  measure the NIT repetition interval and write the minimum capture\n"
+		<< "                  duration that contains a complete NIT as JSON (default output: stdout)\n"
+		<< "  --classify      report network_id and version of the first NIT header of each\n"
+		<< "                  input (files, directories, wildcards, @list) as JSON to stdout\n"
+		<< "  --service=int   write the TSID, transponder, relative TS number and service_type\n"
+		<< "                  of this service_id as JSON instead of the lineup (default output: stdout)\n"
+		<< "  --jobs=int      scan many input files (files, directories, wildcards, @list)\n"
+		<< "                  with this many threads, 0: number of CPUs\n"
+		<< "  --sequential    scan many input files one by one, reading ahead the next file\n"
+		<< "  input           input filename, '-': stdin, 'shm:name': shared memory ring\n"
+		<< "                  'udp://[group]:port', 'rtp://[group]:port': UDP/RTP stream\n"
 		<< "  output          output filename, '-': stdout\n"
 		<< "                  if 'output' is omitted, default filename is used\n";
 
@@ -110,10 +440,61 @@ std::string Config::usage(const std::string& argv0, const std::string& msg) cons
 	return os.str();
 }
 
+void Config::expand_inputs(const std::vector<std::string>& args)
+{
+	for (const auto& arg : args)
+	{
+		if (arg.size() > 1 && arg[0] == '@')
+		{
+			// 1行1ファイルのリストファイル
+			std::ifstream ifs(arg.substr(1));
+			if (!ifs)
+			{
+				throw std::runtime_error("failed to open " + arg.substr(1));
+			}
+			std::string line;
+			while (std::getline(ifs, line))
+			{
+				if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+				if (!line.empty()) { inputs_.emplace_back(line); }
+			}
+		}
+		else if (std::filesystem::is_directory(arg))
+		{
+			std::vector<std::string> files;
+			for (const auto& e : std::filesystem::directory_iterator(arg))
+			{
+				if (e.is_regular_file()) { files.emplace_back(e.path().string()); }
+			}
+			std::sort(files.begin(), files.end());
+			inputs_.insert(inputs_.end(), files.begin(), files.end());
+		}
+#if !defined(_WIN32)
+		else if (arg.find_first_of("*?[") != std::string::npos)
+		{
+			glob_t g{};
+			if (::glob(arg.c_str(), 0, nullptr, &g) == 0)
+			{
+				inputs_.insert(inputs_.end(), g.gl_pathv, g.gl_pathv + g.gl_pathc);
+			}
+			::globfree(&g);
+		}
+#endif
+		else
+		{
+			inputs_.emplace_back(arg);
+		}
+	}
+}
+
 void Config::open_file()
 {
 #if defined(_WIN32)
-	if (input_ == "-")
+	if (Input::is_stream(input_))
+	{
+		fp_input_ = nullptr;
+	}
+	else if (input_ == "-")
 	{
 		auto ec = _setmode(_fileno(stdin), _O_BINARY);
 		if (ec == -1)
@@ -151,7 +532,11 @@ void Config::open_file()
 		}
 	}
 #else
-	if (input_ == "-")
+	if (Input::is_stream(input_))
+	{
+		fp_input_ = nullptr;
+	}
+	else if (input_ == "-")
 	{
 		fp_input_ = stdin;
 	}
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <string>
+#include <vector>
 
 class Config
 {
@@ -13,11 +14,43 @@ public:
 	~Config();
 
 	int32_t sorting() const { return sorting_; }
+	int32_t sorting(const std::string& format) const;
 	const std::string& format() const { return format_; }
+	const std::vector<std::string>& formats() const { return formats_; }
 	const std::string& error() const { return error_; }
 	int32_t buffer_size() const { return BUFFER_SIZE; }
 	const std::string& input() const { return input_; }
 	const std::string& output() const { return output_; }
+	const std::vector<std::string>& inputs() const { return inputs_; }
+	const std::string& output_dir() const { return output_dir_; }
+	bool multi() const { return multi_; }
+	uint64_t max_bytes() const { return max_bytes_; }
+	double timeout() const { return timeout_; }
+	int32_t parallel() const { return parallel_; }
+	int32_t jobs() const { return jobs_; }
+	bool sequential() const { return sequential_; }
+	int32_t probe() const { return probe_; }
+	uint64_t probe_window() const { return probe_window_; }
+	bool bisect() const { return bisect_; }
+	const std::string& cache_dir() const { return cache_dir_; }
+	bool cache_clear() const { return cache_clear_; }
+	bool index() const { return index_; }
+	bool use_index() const { return use_index_; }
+	const std::string& index_file() const { return index_file_; }
+	const std::string& extract_nit() const { return extract_nit_; }
+	bool follow() const { return follow_; }
+	const std::string& checkpoint() const { return checkpoint_; }
+	bool watch() const { return watch_; }
+	bool sections() const { return sections_; }
+	bool check() const { return check_; }
+	bool profile() const { return profile_; }
+	const std::string& profile_output() const { return profile_output_; }
+	// 最初のNITが揃った後も入力の最後まで読む
+	bool full_scan() const { return check_ || profile_; }
+	bool nit_interval() const { return nit_interval_; }
+	bool classify() const { return classify_; }
+	// 問い合わせるservice_id、指定しない場合は-1
+	int32_t service() const { return service_; }
 	std::FILE* fp_input() const { return fp_input_; }
 	std::FILE* fp_output() const { return fp_output_; }
 
@@ -27,14 +60,44 @@ private:
 	static constexpr int32_t BUFFER_SIZE = 188*1024;
 
 	int32_t sorting_ = 0;
+	int32_t sorting_option_ = 0;
 	std::string format_ = "json";
+	std::vector<std::string> formats_;
 	std::string error_;
 	std::string input_ = "-";
 	std::string output_ = "-";
+	std::vector<std::string> inputs_;
+	std::string output_dir_ = ".";
+	bool multi_ = false;
+	uint64_t max_bytes_ = 0;
+	double timeout_ = 0;
+	int32_t parallel_ = 0;
+	int32_t jobs_ = 0;
+	bool sequential_ = false;
+	int32_t probe_ = 0;
+	uint64_t probe_window_ = 0;
+	bool bisect_ = false;
+	std::string cache_dir_;
+	bool cache_clear_ = false;
+	bool index_ = false;
+	bool use_index_ = false;
+	std::string index_file_;
+	std::string extract_nit_;
+	bool follow_ = false;
+	std::string checkpoint_;
+	bool watch_ = false;
+	bool sections_ = false;
+	bool check_ = false;
+	bool profile_ = false;
+	std::string profile_output_;
+	bool nit_interval_ = false;
+	bool classify_ = false;
+	int32_t service_ = -1;
 	std::FILE* fp_input_ = stdin;
 	std::FILE* fp_output_ = stdout;
 
 	std::string usage(const std::string& argv0, const std::string& msg = "") const;
 	void open_file();
 	void close_file();
+	void expand_inputs(const std::vector<std::string>& args);
 };
@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(PX4CHSET_HAS_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(PX4CHSET_HAS_ZSTD)
+#include <zstd.h>
+#endif
+
+#include "decompress.h"
+
+CompressedInput::CompressedInput(Codec codec, std::FILE* fp, std::vector<uint8_t> head, size_t buffer_size, int32_t wait_ms) :
+	codec_(codec),
+	fp_(fp),
+	head_(std::move(head)),
+	buffer_size_(buffer_size),
+	wait_ms_(wait_ms)
+{
+	thread_ = std::thread(&CompressedInput::run, this);
+}
+
+CompressedInput::~CompressedInput()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	thread_.join();
+}
+
+CompressedInput::Codec CompressedInput::detect(const std::vector<uint8_t>& head)
+{
+	if (head.size() >= 2 && head[0] == 0x1f && head[1] == 0x8b)
+	{
+		return Codec::Gzip;
+	}
+	if (head.size() >= 4 && head[0] == 0x28 && head[1] == 0xb5 && head[2] == 0x2f && head[3] == 0xfd)
+	{
+		return Codec::Zstd;
+	}
+	// pzstdやseekable形式は先頭にスキップ可能フレーム(0x184d2a50から0x184d2a5f)を置く
+	if (head.size() >= 4 && (head[0] & 0xf0) == 0x50 && head[1] == 0x2a && head[2] == 0x4d && head[3] == 0x18)
+	{
+		return Codec::Zstd;
+	}
+
+	return Codec::None;
+}
+
+bool CompressedInput::feed(TS::NITSection& nit)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		auto ready = cv_.wait_for(lock, std::chrono::milliseconds(wait_ms_), [this] { return !queue_.empty() || done_; });
+		if (!ready) { return true; }
+		if (queue_.empty())
+		{
+			if (error_) { std::rethrow_exception(error_); }
+			nit.finish();
+			return false;
+		}
+		block_ = std::move(queue_.front());
+		queue_.pop_front();
+	}
+	cv_.notify_all();
+
+	nit.push(block_.data(), limit(block_.size(), nit));
+
+	return true;
+}
+
+void CompressedInput::run()
+{
+	try
+	{
+		switch (codec_)
+		{
+		case Codec::Gzip:
+			inflate_gzip();
+			break;
+		case Codec::Zstd:
+			decompress_zstd();
+			break;
+		default:
+			break;
+		}
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		error_ = std::current_exception();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		done_ = true;
+	}
+	cv_.notify_all();
+}
+
+size_t CompressedInput::read(uint8_t* buf, size_t size)
+{
+	// 判定用に先読みした分を先に返す
+	if (!head_.empty())
+	{
+		auto n = std::min(size, head_.size());
+		std::copy(head_.begin(), head_.begin() + n, buf);
+		head_.erase(head_.begin(), head_.begin() + n);
+		return n;
+	}
+
+	return std::fread(buf, 1, size, fp_);
+}
+
+bool CompressedInput::emit(std::vector<uint8_t> block)
+{
+	// キューが一杯の間は圧縮ストリームの読み込みを止める
+	std::unique_lock<std::mutex> lock(mutex_);
+	cv_.wait(lock, [this] { return queue_.size() < QUEUE_SIZE || stop_; });
+	if (stop_) { return false; }
+	queue_.emplace_back(std::move(block));
+	lock.unlock();
+	cv_.notify_all();
+
+	return true;
+}
+
+#if defined(PX4CHSET_HAS_ZLIB)
+void CompressedInput::inflate_gzip()
+{
+	z_stream z{};
+	if (inflateInit2(&z, 15 + 32) != Z_OK)
+	{
+		throw std::runtime_error("failed to initialize zlib");
+	}
+
+	std::vector<uint8_t> in(buffer_size_);
+	std::vector<uint8_t> out(buffer_size_);
+	while (!stop_)
+	{
+		auto size = read(in.data(), in.size());
+		if (size == 0) { break; }
+
+		z.next_in = in.data();
+		z.avail_in = static_cast<uInt>(size);
+		do
+		{
+			z.next_out = out.data();
+			z.avail_out = static_cast<uInt>(out.size());
+			auto ret = inflate(&z, Z_NO_FLUSH);
+			if (ret == Z_BUF_ERROR) { break; }
+			if (ret != Z_OK && ret != Z_STREAM_END)
+			{
+				inflateEnd(&z);
+				throw std::runtime_error("failed to inflate gzip input");
+			}
+
+			auto produced = out.size() - z.avail_out;
+			if (produced > 0 && !emit({out.begin(), out.begin() + produced})) { break; }
+
+			// 連結されたgzipメンバに対応
+			if (ret == Z_STREAM_END)
+			{
+				inflateReset(&z);
+			}
+		} while ((z.avail_in > 0 || z.avail_out == 0) && !stop_);
+	}
+
+	inflateEnd(&z);
+}
+#else
+void CompressedInput::inflate_gzip()
+{
+	throw std::runtime_error("gzip input is not supported (built without zlib)");
+}
+#endif
+
+#if defined(PX4CHSET_HAS_ZSTD)
+void CompressedInput::decompress_zstd()
+{
+	auto ctx = ZSTD_createDCtx();
+	if (!ctx)
+	{
+		throw std::runtime_error("failed to initialize zstd");
+	}
+
+	std::vector<uint8_t> in(ZSTD_DStreamInSize());
+	std::vector<uint8_t> out(std::max(buffer_size_, ZSTD_DStreamOutSize()));
+	while (!stop_)
+	{
+		auto size = read(in.data(), in.size());
+		if (size == 0) { break; }
+
+		// スキップ可能フレーム等で出力がない呼び出しがあっても入力を使い切るまで続ける
+		ZSTD_inBuffer input{in.data(), size, 0};
+		ZSTD_outBuffer output{out.data(), out.size(), out.size()};
+		while ((input.pos < input.size || output.pos == output.size) && !stop_)
+		{
+			output.pos = 0;
+			auto ret = ZSTD_decompressStream(ctx, &output, &input);
+			if (ZSTD_isError(ret))
+			{
+				ZSTD_freeDCtx(ctx);
+				throw std::runtime_error("failed to decompress zstd input");
+			}
+
+			if (output.pos > 0 && !emit({out.begin(), out.begin() + output.pos})) { break; }
+		}
+	}
+
+	ZSTD_freeDCtx(ctx);
+}
+#else
+void CompressedInput::decompress_zstd()
+{
+	throw std::runtime_error("zstd input is not supported (built without libzstd)");
+}
+#endif
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "input.h"
+
+// 圧縮されたTSファイルを別スレッドで展開しながら読み込む
+class CompressedInput : public Input
+{
+public:
+	enum class Codec
+	{
+		None,
+		Gzip,
+		Zstd,
+	};
+
+	static constexpr int32_t WAIT_MS = 100;
+
+	// wait_msは展開済みのデータを待つ時間、0の場合は待たずに戻る
+	CompressedInput(Codec codec, std::FILE* fp, std::vector<uint8_t> head, size_t buffer_size, int32_t wait_ms = WAIT_MS);
+	virtual ~CompressedInput();
+
+	bool feed(TS::NITSection& nit) override;
+
+	static Codec detect(const std::vector<uint8_t>& head);
+
+private:
+	static constexpr size_t QUEUE_SIZE = 4;
+
+	Codec codec_ = Codec::None;
+	std::FILE* fp_ = nullptr;
+	std::vector<uint8_t> head_;
+	size_t buffer_size_ = 0;
+	int32_t wait_ms_ = WAIT_MS;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::vector<uint8_t>> queue_;
+	std::vector<uint8_t> block_;
+	std::atomic<bool> stop_ = false;
+	bool done_ = false;
+	std::exception_ptr error_;
+
+	void run();
+	size_t read(uint8_t* buf, size_t size);
+	bool emit(std::vector<uint8_t> block);
+	void inflate_gzip();
+	void decompress_zstd();
+};
@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "json.hpp"
+
+#include "decompress.h"
+#include "follow.h"
+#include "lineup.h"
+#include "TSNITSection.h"
+
+namespace
+{
+	std::string to_hex(const std::vector<uint8_t>& data)
+	{
+		std::ostringstream os;
+		os << std::hex << std::setfill('0');
+		for (auto c : data)
+		{
+			os << std::setw(2) << static_cast<int>(c);
+		}
+		return os.str();
+	}
+
+	std::vector<uint8_t> from_hex(const std::string& str)
+	{
+		std::vector<uint8_t> data;
+		for (size_t i = 0; i + 1 < str.size(); i += 2)
+		{
+			data.push_back(static_cast<uint8_t>(std::stoi(str.substr(i, 2), nullptr, 16)));
+		}
+		return data;
+	}
+}
+
+#if !defined(_WIN32)
+Follow::~Follow()
+{
+	if (inotify_fd_ >= 0)
+	{
+		::close(inotify_fd_);
+	}
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+	}
+}
+
+bool Follow::run(TS::NITSection& nit, Budget& budget)
+{
+	const auto& input = config_.input();
+	fd_ = ::open(input.c_str(), O_RDONLY);
+	if (fd_ < 0)
+	{
+		throw std::runtime_error("failed to open " + input);
+	}
+
+	struct stat st;
+	if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		throw std::runtime_error("--follow and --checkpoint require a regular file");
+	}
+	dev_ = static_cast<uint64_t>(st.st_dev);
+	ino_ = static_cast<uint64_t>(st.st_ino);
+
+	// 圧縮ファイルは途中から展開できない
+	std::vector<uint8_t> head(4);
+	auto size = ::pread(fd_, head.data(), head.size(), 0);
+	head.resize(size > 0 ? size : 0);
+	if (CompressedInput::detect(head) != CompressedInput::Codec::None)
+	{
+		throw std::runtime_error("--follow and --checkpoint require an uncompressed TS file");
+	}
+
+	if (!config_.checkpoint().empty() && !load(nit, static_cast<uint64_t>(st.st_size)))
+	{
+		nit.reset();
+	}
+
+	if (config_.follow())
+	{
+		inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotify_fd_ < 0 || ::inotify_add_watch(inotify_fd_, input.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0)
+		{
+			throw std::runtime_error("failed to watch " + input);
+		}
+	}
+
+	// 前回までに読み込んだ位置から新しく書き込まれた分のみ読み込む
+	std::vector<uint8_t> buf(config_.buffer_size());
+	auto offset = nit.input_bytes();
+	while (true)
+	{
+		auto n = ::pread(fd_, buf.data(), buf.size(), static_cast<off_t>(offset));
+		if (n < 0)
+		{
+			if (errno == EINTR) { continue; }
+			throw std::runtime_error("failed to read " + input);
+		}
+
+		if (n > 0)
+		{
+			offset += static_cast<uint64_t>(n);
+			nit.push(buf.data(), static_cast<size_t>(n));
+			if (nit.on_update())
+			{
+				if (!config_.checkpoint().empty())
+				{
+					std::remove(config_.checkpoint().c_str());
+				}
+				return true;
+			}
+		}
+		else if (!config_.follow() || !wait())
+		{
+			break;
+		}
+
+		if (budget.exhausted(nit)) { break; }
+	}
+
+	if (!config_.checkpoint().empty())
+	{
+		save(nit);
+	}
+
+	return false;
+}
+
+bool Follow::load(TS::NITSection& nit, uint64_t file_size) const
+{
+	std::ifstream ifs(config_.checkpoint());
+	if (!ifs) { return false; }
+
+	try
+	{
+		auto j = nlohmann::json::parse(ifs);
+
+		// 別のファイルや短くなったファイルは最初から読み込む
+		uint64_t offset = j.at("offset");
+		if (j.at("dev") != dev_ || j.at("ino") != ino_ || offset > file_size)
+		{
+			return false;
+		}
+
+		nit.resume(offset, from_hex(j.at("rest")), from_hex(j.at("packets")), j.at("section_offset"));
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void Follow::save(const TS::NITSection& nit) const
+{
+	// 組み立て途中のセクションのパケットと同期できずに持ち越したデータを保存する
+	auto j = nlohmann::json::object();
+	j["input"] = config_.input();
+	j["dev"] = dev_;
+	j["ino"] = ino_;
+	j["offset"] = nit.input_bytes();
+	j["rest"] = to_hex(nit.rest());
+	j["packets"] = to_hex(nit.in_progress() ? nit.packets() : std::vector<uint8_t>());
+	j["section_offset"] = nit.section_offset();
+
+	Lineup::write(config_.checkpoint(), j.dump(4) + '\n');
+}
+
+bool Follow::wait() const
+{
+	// ファイルへの書き込みを待ち、待機時間を区切って打ち切り条件を確認できるようにする
+	pollfd pfd{inotify_fd_, POLLIN, 0};
+	auto ret = ::poll(&pfd, 1, WAIT_MS);
+	if (ret < 0 && errno != EINTR) { return false; }
+
+	if (ret > 0)
+	{
+		std::vector<uint8_t> events(4096);
+		while (::read(inotify_fd_, events.data(), events.size()) > 0) {}
+	}
+
+	return true;
+}
+#else
+Follow::~Follow()
+{
+}
+
+bool Follow::run(TS::NITSection& nit, Budget& budget)
+{
+	throw std::runtime_error("--follow and --checkpoint are not supported on this platform");
+}
+
+bool Follow::load(TS::NITSection& nit, uint64_t file_size) const
+{
+	return false;
+}
+
+void Follow::save(const TS::NITSection& nit) const
+{
+}
+
+bool Follow::wait() const
+{
+	return false;
+}
+#endif
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "budget.h"
+#include "config.h"
+#include "TSNITSection.h"
+
+// 書き込み中のTSファイルを読み込んだ位置から続けて走査する
+// 途中の状態はチェックポイントに保存し、次回はその続きから読み込む
+class Follow
+{
+public:
+	Follow(const Config& config) : config_(config) {}
+	virtual ~Follow();
+
+	bool run(TS::NITSection& nit, Budget& budget);
+
+private:
+	static constexpr int32_t WAIT_MS = 100;
+
+	const Config& config_;
+	int fd_ = -1;
+	int inotify_fd_ = -1;
+	uint64_t dev_ = 0;
+	uint64_t ino_ = 0;
+
+	bool load(TS::NITSection& nit, uint64_t file_size) const;
+	void save(const TS::NITSection& nit) const;
+	bool wait() const;
+};
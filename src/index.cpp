@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include "json.hpp"
+
+#include "index.h"
+#include "input.h"
+#include "TSNITSection.h"
+
+std::string Index::run()
+{
+	TS::NITSection nit;
+	nit.set_section_handler([this](const TS::NITSection& s) {
+		entries_.push_back({s.section_offset(), s.header().version_number(), s.crc(), s.packet_offsets()});
+	});
+
+	auto input = Input::open(config_);
+	input->set_max_bytes(config_.max_bytes());
+	// 終端まで読み込み、セクションが揃う度にハンドラで記録する
+	while (input->feed(nit)) {}
+
+	auto j = nlohmann::json::object();
+	j["input"] = config_.input();
+	// 入力上のパケット長、判定できなかった場合は188
+	j["packet_size"] = nit.stride() ? nit.stride() : TS::Packet::size();
+	j["bytes"] = nit.input_bytes();
+	j["sync_offset"] = nit.first_sync_offset();
+	j["network_id"] = nit.header().network_id();
+	j["sections"] = nlohmann::json::array();
+	for (const auto& e : entries_)
+	{
+		std::ostringstream crc;
+		crc << std::hex << std::setw(8) << std::setfill('0') << e.crc;
+		j["sections"].push_back({
+			{"offset", e.offset},
+			{"version", e.version_number},
+			{"crc", crc.str()},
+			{"packets", e.packets},
+		});
+	}
+
+	return j.dump(4);
+}
+
+bool Index::load(TS::NITSection& nit) const
+{
+	std::ifstream ifs(config_.index_file());
+	if (!ifs)
+	{
+		throw std::runtime_error("failed to open " + config_.index_file());
+	}
+	auto j = nlohmann::json::parse(ifs, nullptr, false);
+	if (j.is_discarded() || !j.contains("sections") || j.at("sections").empty())
+	{
+		return false;
+	}
+
+	std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(config_.input().c_str(), "rb"), &std::fclose);
+	if (!fp)
+	{
+		throw std::runtime_error("failed to open " + config_.input());
+	}
+
+	// 各パケットの位置から188バイトずつ読み込み、同期を経ずに組み立てる
+	const auto& section = j.at("sections").front();
+	std::vector<uint8_t> packets;
+	for (auto offset : section.at("packets").get<std::vector<uint64_t>>())
+	{
+		std::array<uint8_t, 188> packet{};
+#if defined(_WIN32)
+		auto size = (_fseeki64(fp.get(), static_cast<int64_t>(offset), SEEK_SET) == 0)
+			? std::fread(packet.data(), 1, packet.size(), fp.get()) : 0;
+#else
+		auto n = ::pread(::fileno(fp.get()), packet.data(), packet.size(), static_cast<off_t>(offset));
+		auto size = n > 0 ? static_cast<size_t>(n) : 0;
+#endif
+		if (size != packet.size()) { return false; }
+		packets.insert(packets.end(), packet.begin(), packet.end());
+	}
+
+	nit.reset();
+	nit.push_packets(packets.data(), packets.size());
+
+	// CRCが一致し、索引と同じセクション(バージョンとCRC)であること
+	// 索引のCRCは16進数の文字列
+	const auto& crc = section.value("crc", nlohmann::json());
+	return nit.on_update()
+		&& nit.header().version_number() == section.at("version").get<int32_t>()
+		&& crc.is_string()
+		&& nit.crc() == std::stoul(crc.get<std::string>(), nullptr, 16);
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "TSNITSection.h"
+
+// 入力を最後まで1回読み込み、NITセクションが現れる全ての位置を索引として出力する
+class Index
+{
+public:
+	Index(const Config& config) : config_(config) {}
+	virtual ~Index() = default;
+
+	// 索引をJSONで返す
+	std::string run();
+	// 索引の最初のセクションのパケットのみを入力から読み込んでNITを組み立てる
+	// 索引が入力と一致しない場合はfalse
+	bool load(TS::NITSection& nit) const;
+
+private:
+	struct Entry
+	{
+		uint64_t offset = 0;
+		uint8_t version_number = 0;
+		uint32_t crc = 0;
+		// セクションを運んだ各パケットの位置
+		std::vector<uint64_t> packets;
+	};
+
+	const Config& config_;
+	std::vector<Entry> entries_;
+};
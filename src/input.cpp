@@ -0,0 +1,496 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "budget.h"
+#include "config.h"
+#include "decompress.h"
+#include "input.h"
+
+namespace
+{
+	std::vector<uint8_t> read_head(std::FILE* fp)
+	{
+		// 先頭のマジックナンバーで圧縮形式を判定
+		// 以降はディスクリプタから直接読み込むためバッファリングしない
+		std::setvbuf(fp, nullptr, _IONBF, 0);
+		std::vector<uint8_t> head(4);
+		head.resize(std::fread(head.data(), 1, head.size(), fp));
+
+		return head;
+	}
+}
+
+bool Input::is_stream(const std::string& input)
+{
+	return input.rfind("shm:", 0) == 0
+		|| input.rfind("udp://", 0) == 0
+		|| input.rfind("rtp://", 0) == 0;
+}
+
+size_t Input::limit(size_t size, const TS::NITSection& nit) const
+{
+	// --max-bytesを超える分はNITSectionへ渡さない
+	if (max_bytes_ == 0) { return size; }
+	if (nit.input_bytes() >= max_bytes_) { return 0; }
+	return static_cast<size_t>(std::min<uint64_t>(size, max_bytes_ - nit.input_bytes()));
+}
+
+std::unique_ptr<Input> Input::open(const Config& config)
+{
+	const auto& input = config.input();
+	if (input.rfind("shm:", 0) == 0)
+	{
+		return std::make_unique<ShmInput>(input.substr(4), config.buffer_size());
+	}
+	if (input.rfind("udp://", 0) == 0)
+	{
+		return std::make_unique<UdpInput>(input.substr(6), false);
+	}
+	if (input.rfind("rtp://", 0) == 0)
+	{
+		return std::make_unique<UdpInput>(input.substr(6), true);
+	}
+
+	if (config.sections())
+	{
+		return std::make_unique<SectionInput>(config.fp_input(), config.buffer_size());
+	}
+
+#if !defined(_WIN32)
+	// 先頭を判定する前にデータが来ない場合は圧縮されていないものとして扱う
+	pollfd pfd{::fileno(config.fp_input()), POLLIN, 0};
+	auto timeout = (config.timeout() > 0) ? static_cast<int>(config.timeout() * 1000) : -1;
+	if (::poll(&pfd, 1, timeout) == 0)
+	{
+		std::setvbuf(config.fp_input(), nullptr, _IONBF, 0);
+		return std::make_unique<FileInput>(config.fp_input(), std::vector<uint8_t>(), config.buffer_size());
+	}
+#endif
+
+	return open_file(config.fp_input(), config.buffer_size());
+}
+
+std::unique_ptr<Input> Input::open_file(std::FILE* fp, size_t buffer_size)
+{
+	auto head = read_head(fp);
+	auto codec = CompressedInput::detect(head);
+	if (codec != CompressedInput::Codec::None)
+	{
+		return std::make_unique<CompressedInput>(codec, fp, std::move(head), buffer_size);
+	}
+
+	return std::make_unique<FileInput>(fp, std::move(head), buffer_size);
+}
+
+std::unique_ptr<Input> Input::open_file(std::FILE* fp, std::vector<uint8_t>& buf)
+{
+	auto head = read_head(fp);
+	auto codec = CompressedInput::detect(head);
+	if (codec != CompressedInput::Codec::None)
+	{
+		return std::make_unique<CompressedInput>(codec, fp, std::move(head), buf.size());
+	}
+
+	return std::make_unique<FileInput>(fp, std::move(head), buf);
+}
+
+void Input::drain(TS::NITSection& nit, Budget& budget, const std::function<bool()>& done)
+{
+	while (feed(nit))
+	{
+		if (done()) { return; }
+		// TSでないファイルは早めに打ち切る
+		if (nit.not_ts()) { throw std::runtime_error("not a TS file"); }
+		if (budget.exhausted(nit)) { return; }
+	}
+}
+
+#if !defined(_WIN32)
+std::unique_ptr<Input> Input::open_nonblock(const std::string& input, size_t buffer_size)
+{
+	// 複数入力を1スレッドで扱うため読み込みで待機しない入力を開く
+	if (input.rfind("shm:", 0) == 0)
+	{
+		return std::make_unique<ShmInput>(input.substr(4), buffer_size, 0);
+	}
+	if (input.rfind("udp://", 0) == 0)
+	{
+		return std::make_unique<UdpInput>(input.substr(6), false);
+	}
+	if (input.rfind("rtp://", 0) == 0)
+	{
+		return std::make_unique<UdpInput>(input.substr(6), true);
+	}
+
+	auto fd = ::open(input.c_str(), O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+	{
+		throw std::runtime_error("failed to open " + input);
+	}
+
+	// 圧縮ファイルは展開スレッドに任せる
+	struct stat st;
+	std::vector<uint8_t> head(4);
+	if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+	{
+		auto size = ::pread(fd, head.data(), head.size(), 0);
+		head.resize(size > 0 ? size : 0);
+		auto codec = CompressedInput::detect(head);
+		if (codec != CompressedInput::Codec::None)
+		{
+			head.clear();
+			return std::make_unique<CompressedInput>(codec, ::fdopen(fd, "rb"), std::move(head), buffer_size, 0);
+		}
+	}
+
+	return std::make_unique<FdInput>(fd, buffer_size);
+}
+#else
+std::unique_ptr<Input> Input::open_nonblock(const std::string& input, size_t buffer_size)
+{
+	throw std::runtime_error("multiple inputs are not supported on this platform");
+}
+#endif
+
+bool FileInput::feed(TS::NITSection& nit)
+{
+	auto offset = head_.size();
+	std::copy(head_.begin(), head_.end(), buf_.begin());
+	head_.clear();
+
+#if !defined(_WIN32)
+	// パイプ等で入力が途切れても打ち切り条件を確認できるよう待機時間を区切る
+	pollfd pfd{::fileno(fp_), POLLIN, 0};
+	if (offset == 0 && ::poll(&pfd, 1, WAIT_MS) == 0) { return true; }
+
+	auto n = ::read(pfd.fd, buf_.data() + offset, buf_.size() - offset);
+	if (n < 0 && errno != EINTR)
+	{
+		throw std::runtime_error("failed to read input");
+	}
+	auto size = offset + ((n > 0) ? static_cast<size_t>(n) : 0);
+	if (size == 0 && n < 0) { return true; }
+#else
+	auto size = offset + std::fread(buf_.data() + offset, 1, buf_.size() - offset, fp_);
+#endif
+	if (size == 0)
+	{
+		// 終端に達したので持ち越した最後のパケットを処理する
+		nit.finish();
+		return false;
+	}
+	nit.push(buf_.data(), limit(size, nit));
+	return true;
+}
+
+bool SectionInput::feed(TS::NITSection& nit)
+{
+#if !defined(_WIN32)
+	pollfd pfd{::fileno(fp_), POLLIN, 0};
+	if (::poll(&pfd, 1, WAIT_MS) == 0) { return true; }
+
+	auto n = ::read(pfd.fd, buf_.data(), buf_.size());
+	if (n < 0 && errno != EINTR)
+	{
+		throw std::runtime_error("failed to read input");
+	}
+	auto size = (n > 0) ? static_cast<size_t>(n) : 0;
+	if (size == 0 && n < 0) { return true; }
+#else
+	auto size = std::fread(buf_.data(), 1, buf_.size(), fp_);
+#endif
+	if (size == 0)
+	{
+		// 終端では揃わないセクションを待たずに残りから探し直す
+		parse(nit, true);
+		return false;
+	}
+	pending_.insert(pending_.end(), buf_.begin(), buf_.begin() + size);
+	parse(nit, false);
+
+	return true;
+}
+
+void SectionInput::parse(TS::NITSection& nit, bool eof)
+{
+	// セクション単位に区切り、NIT(自ネットワーク)のみをパケット処理を通さずに渡す
+	size_t pos = 0;
+	while (pending_.size() - pos >= 3 && !nit.on_update())
+	{
+		const auto* p = pending_.data() + pos;
+		if (p[0] == 0xff)
+		{
+			// スタッフィング
+			pos++;
+			continue;
+		}
+
+		// section_syntax_indicatorがない(CRCで確かめられない)、長さがPSIの上限を超える、
+		// 終端までに揃わない、CRCが一致しない場合は区切りを見失ったものとして1バイト進めて探し直す
+		size_t section_size = 3 + (((p[1] & 0x0f) << 8) | p[2]);
+		if (!(p[1] & 0x80) || section_size < 12 || section_size > MAX_SECTION_SIZE
+			|| (eof && pending_.size() - pos < section_size))
+		{
+			pos++;
+			skipped_++;
+			continue;
+		}
+		if (pending_.size() - pos < section_size) { break; }
+		if (TS::Packet::crc32(p, section_size) != 0)
+		{
+			pos++;
+			skipped_++;
+			continue;
+		}
+
+		if (p[0] == 0x40
+			&& ((p[3] << 8) | p[4]) == 0x0004
+			&& (p[5] & 0x01)
+			)
+		{
+			nit.push_section(p, section_size, consumed_ + pos);
+			nit_sections_++;
+		}
+		sections_++;
+		pos += section_size;
+	}
+	pending_.erase(pending_.begin(), pending_.begin() + pos);
+	consumed_ += pos;
+}
+
+std::string SectionInput::progress() const
+{
+	// パケットを通さないためNITSectionの計数の代わりに読んだセクション数を報告
+	return "read " + std::to_string(consumed_ + pending_.size()) + " bytes, "
+		+ "seen " + std::to_string(sections_) + " sections, "
+		+ std::to_string(nit_sections_) + " NIT sections, "
+		+ "skipped " + std::to_string(skipped_) + " bytes";
+}
+
+#if !defined(_WIN32)
+FdInput::FdInput(int fd, size_t buffer_size) :
+	fd_(fd),
+	buf_(buffer_size)
+{
+	// 通常ファイルはepollで待機できないので常に読み込み可能として扱う
+	struct stat st;
+	pollable_ = (::fstat(fd_, &st) == 0) && !S_ISREG(st.st_mode);
+}
+
+FdInput::~FdInput()
+{
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+	}
+}
+
+bool FdInput::feed(TS::NITSection& nit)
+{
+	auto size = ::read(fd_, buf_.data(), buf_.size());
+	if (size < 0)
+	{
+		if (errno == EAGAIN || errno == EINTR) { return true; }
+		throw std::runtime_error("failed to read input");
+	}
+	if (size == 0)
+	{
+		nit.finish();
+		return false;
+	}
+
+	nit.push(buf_.data(), limit(static_cast<size_t>(size), nit));
+	return true;
+}
+#else
+FdInput::FdInput(int fd, size_t buffer_size)
+{
+	throw std::runtime_error("descriptor input is not supported on this platform");
+}
+
+FdInput::~FdInput()
+{
+}
+
+bool FdInput::feed(TS::NITSection& nit)
+{
+	return false;
+}
+#endif
+
+ShmInput::ShmInput(const std::string& name, size_t buffer_size, int32_t wait_ms) :
+	buffer_size_(buffer_size),
+	wait_ms_(wait_ms)
+{
+	ring_.attach(name);
+}
+
+bool ShmInput::feed(TS::NITSection& nit)
+{
+	// 共有メモリ上のデータを直接NITSectionへ渡す
+	const uint8_t* data = nullptr;
+	for (auto i = 0; i <= wait_ms_; i++)
+	{
+		auto closed = ring_.closed();
+		auto size = limit(std::min(ring_.peek(&data), buffer_size_), nit);
+		if (size > 0)
+		{
+			nit.push(data, size);
+			ring_.consume(size);
+			return true;
+		}
+		if (closed) { return false; }
+		if (i < wait_ms_)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	return true;
+}
+
+size_t UdpInput::strip_rtp(const uint8_t* buf, size_t size, bool rtp, size_t* offset)
+{
+	// udp://はTSで始まらないデータグラムのみRTPとして扱う
+	*offset = 0;
+	if (size == 0) { return 0; }
+	if (!rtp && buf[0] == 0x47) { return size; }
+	if (size < 12 || (buf[0] & 0xc0) != 0x80) { return 0; }
+
+	size_t header = 12 + (buf[0] & 0x0f) * 4;
+	if ((buf[0] & 0x10) && size >= header + 4)
+	{
+		header += 4 + ((buf[header + 2] << 8) | buf[header + 3]) * 4;
+	}
+	size_t padding = (buf[0] & 0x20) ? buf[size - 1] : 0;
+	if (header + padding >= size) { return 0; }
+
+	*offset = header;
+	return size - header - padding;
+}
+
+#if !defined(_WIN32)
+UdpInput::UdpInput(const std::string& address, bool rtp) :
+	rtp_(rtp),
+	buf_(BATCH_SIZE * DATAGRAM_SIZE)
+{
+	auto pos = address.rfind(':');
+	if (pos == std::string::npos)
+	{
+		throw std::runtime_error("invalid address " + address);
+	}
+	auto host = address.substr(0, pos);
+	auto port = std::stoi(address.substr(pos + 1));
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(static_cast<uint16_t>(port));
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (!host.empty() && ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+	{
+		throw std::runtime_error("invalid address " + address);
+	}
+
+	fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd_ < 0)
+	{
+		throw std::runtime_error("failed to create socket");
+	}
+
+	int on = 1;
+	int rcvbuf = 8 * 1024 * 1024;
+	::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		throw std::runtime_error("failed to bind " + address);
+	}
+
+	if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr)))
+	{
+		ip_mreq mreq{};
+		mreq.imr_multiaddr = addr.sin_addr;
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+		if (::setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+		{
+			throw std::runtime_error("failed to join " + host);
+		}
+	}
+}
+
+UdpInput::~UdpInput()
+{
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+	}
+}
+
+bool UdpInput::feed(TS::NITSection& nit)
+{
+	pollfd pfd{fd_, POLLIN, 0};
+	if (::poll(&pfd, 1, WAIT_MS) <= 0) { return true; }
+
+	iovec iov[BATCH_SIZE];
+	mmsghdr msgs[BATCH_SIZE];
+	std::memset(msgs, 0, sizeof(msgs));
+	for (size_t i = 0; i < BATCH_SIZE; i++)
+	{
+		iov[i].iov_base = buf_.data() + i * DATAGRAM_SIZE;
+		iov[i].iov_len = DATAGRAM_SIZE;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	auto count = ::recvmmsg(fd_, msgs, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+	if (count <= 0) { return true; }
+
+	// RTPヘッダを除いたペイロードを詰めてまとめてNITSectionへ渡す
+	size_t total = 0;
+	for (auto i = 0; i < count; i++)
+	{
+		size_t offset = 0;
+		auto p = buf_.data() + i * DATAGRAM_SIZE;
+		auto size = strip_rtp(p, msgs[i].msg_len, rtp_, &offset);
+		std::memmove(buf_.data() + total, p + offset, size);
+		total += size;
+	}
+	nit.push(buf_.data(), limit(total, nit));
+
+	return true;
+}
+#else
+UdpInput::UdpInput(const std::string& address, bool rtp)
+{
+	throw std::runtime_error("udp input is not supported on this platform");
+}
+
+UdpInput::~UdpInput()
+{
+}
+
+bool UdpInput::feed(TS::NITSection& nit)
+{
+	return false;
+}
+#endif
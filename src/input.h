@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "shmring.h"
+#include "TSNITSection.h"
+
+class Budget;
+class Config;
+
+// TSの入力元
+class Input
+{
+public:
+	Input() = default;
+	virtual ~Input() = default;
+
+	// 入力元から読み込んだデータをNITSectionへ渡す
+	// 入力が終了した場合はfalseを返す
+	virtual bool feed(TS::NITSection& nit) = 0;
+
+	// epollで待機できるディスクリプタ、待機できない場合は-1
+	virtual int fd() const { return -1; }
+
+	// NITSectionの計数に表れない読み込みの進捗、ない場合は空
+	virtual std::string progress() const { return {}; }
+
+	void set_max_bytes(uint64_t max_bytes) { max_bytes_ = max_bytes; }
+	// 終端に達するか、doneが真を返すか、打ち切られるまで読み込む
+	// TSのパケットが見つからない入力は例外
+	void drain(TS::NITSection& nit, Budget& budget, const std::function<bool()>& done);
+
+	static bool is_stream(const std::string& input);
+	static std::unique_ptr<Input> open(const Config& config);
+	// 開いたファイルの先頭のマジックナンバーで圧縮形式を判定して読み込む
+	static std::unique_ptr<Input> open_file(std::FILE* fp, size_t buffer_size);
+	// 圧縮されていない場合は呼び出し側の読み込みバッファを使い回す
+	static std::unique_ptr<Input> open_file(std::FILE* fp, std::vector<uint8_t>& buf);
+	static std::unique_ptr<Input> open_nonblock(const std::string& input, size_t buffer_size);
+
+protected:
+	size_t limit(size_t size, const TS::NITSection& nit) const;
+
+private:
+	uint64_t max_bytes_ = 0;
+};
+
+class FileInput : public Input
+{
+public:
+	FileInput(std::FILE* fp, std::vector<uint8_t> head, size_t buffer_size) :
+		fp_(fp),
+		head_(std::move(head)),
+		own_(buffer_size),
+		buf_(own_)
+	{}
+	// 呼び出し側の読み込みバッファを使い回す
+	FileInput(std::FILE* fp, std::vector<uint8_t> head, std::vector<uint8_t>& buf) :
+		fp_(fp),
+		head_(std::move(head)),
+		buf_(buf)
+	{}
+	virtual ~FileInput() = default;
+
+	bool feed(TS::NITSection& nit) override;
+
+private:
+	static constexpr int32_t WAIT_MS = 100;
+
+	std::FILE* fp_ = nullptr;
+	std::vector<uint8_t> head_;
+	std::vector<uint8_t> own_;
+	std::vector<uint8_t>& buf_;
+};
+
+// CRCを含むNITのセクションを並べたファイル(デマルチプレクサのセクションフィルタの出力等)
+class SectionInput : public Input
+{
+public:
+	SectionInput(std::FILE* fp, size_t buffer_size) :
+		fp_(fp),
+		buf_(buffer_size)
+	{}
+	virtual ~SectionInput() = default;
+
+	bool feed(TS::NITSection& nit) override;
+	std::string progress() const override;
+
+private:
+	static constexpr int32_t WAIT_MS = 100;
+	// section_lengthの上限1021バイトを含むセクションの大きさ
+	static constexpr size_t MAX_SECTION_SIZE = 1024;
+
+	std::FILE* fp_ = nullptr;
+	std::vector<uint8_t> buf_;
+	std::vector<uint8_t> pending_;
+	uint64_t consumed_ = 0;
+	uint64_t sections_ = 0;
+	uint64_t nit_sections_ = 0;
+	// 区切りを見失って読み飛ばしたバイト数
+	uint64_t skipped_ = 0;
+
+	void parse(TS::NITSection& nit, bool eof);
+};
+
+class FdInput : public Input
+{
+public:
+	FdInput(int fd, size_t buffer_size);
+	virtual ~FdInput();
+
+	bool feed(TS::NITSection& nit) override;
+	int fd() const override { return pollable_ ? fd_ : -1; }
+
+private:
+	int fd_ = -1;
+	bool pollable_ = false;
+	std::vector<uint8_t> buf_;
+};
+
+class ShmInput : public Input
+{
+public:
+	static constexpr int32_t WAIT_MS = 100;
+
+	ShmInput(const std::string& name, size_t buffer_size, int32_t wait_ms = WAIT_MS);
+	virtual ~ShmInput() = default;
+
+	bool feed(TS::NITSection& nit) override;
+
+private:
+	ShmRing ring_;
+	size_t buffer_size_ = 0;
+	int32_t wait_ms_ = WAIT_MS;
+};
+
+class UdpInput : public Input
+{
+public:
+	UdpInput(const std::string& address, bool rtp);
+	virtual ~UdpInput();
+
+	bool feed(TS::NITSection& nit) override;
+	int fd() const override { return fd_; }
+
+	static size_t strip_rtp(const uint8_t* buf, size_t size, bool rtp, size_t* offset);
+
+private:
+	static constexpr int32_t WAIT_MS = 100;
+	static constexpr size_t BATCH_SIZE = 64;
+	static constexpr size_t DATAGRAM_SIZE = 2048;
+
+	int fd_ = -1;
+	bool rtp_ = false;
+	std::vector<uint8_t> buf_;
+};
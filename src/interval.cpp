@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "input.h"
+#include "interval.h"
+#include "profile.h"
+#include "TSNITSection.h"
+
+std::string Interval::run()
+{
+	TS::NITSection nit;
+	Profile profile;
+	nit.set_section_handler([this](const TS::NITSection& s) {
+		entries_.push_back({s.section_offset(), s.complete_offset()});
+	});
+	nit.set_packet_handler([&profile](const TS::NITSection&, const uint8_t* buf, size_t size) {
+		profile.push(buf, size);
+	});
+
+	auto input = Input::open(config_);
+	input->set_max_bytes(config_.max_bytes());
+	while (input->feed(nit)) {}
+
+	if (entries_.empty())
+	{
+		throw std::runtime_error("NIT packets not found. Check recorded channel or time.\n"
+			"read " + std::to_string(nit.input_bytes()) + " bytes");
+	}
+	auto duration = profile.duration();
+	if (duration <= 0)
+	{
+		throw std::runtime_error("PCR not found. Cannot convert offsets to time");
+	}
+
+	// 入力全体の平均ビットレートで位置を秒に換算する
+	auto bytes_per_second = nit.input_bytes() / duration;
+	auto seconds = [bytes_per_second](uint64_t bytes) { return bytes / bytes_per_second; };
+
+	auto j = nlohmann::json::object();
+	j["input"] = config_.input();
+	j["bytes"] = nit.input_bytes();
+	j["duration"] = duration;
+	j["bitrate"] = static_cast<uint64_t>(bytes_per_second * 8);
+	j["sections"] = entries_.size();
+	j["first_complete"] = seconds(entries_.front().complete_offset);
+
+	// 1つのセクションを運ぶのに掛かる最長の時間
+	uint64_t span = 0;
+	for (const auto& e : entries_)
+	{
+		span = std::max(span, e.complete_offset - e.section_offset);
+	}
+	j["span"] = seconds(span);
+
+	if (entries_.size() < 2)
+	{
+		// 間隔が分からない場合は最初に揃うまでの時間のみ
+		j["interval"] = nullptr;
+		j["minimum_capture"] = nullptr;
+		return j.dump(4);
+	}
+
+	uint64_t min_interval = UINT64_MAX;
+	uint64_t max_interval = 0;
+	for (size_t i = 1; i < entries_.size(); i++)
+	{
+		auto interval = entries_[i].section_offset - entries_[i - 1].section_offset;
+		min_interval = std::min(min_interval, interval);
+		max_interval = std::max(max_interval, interval);
+	}
+	auto average = (entries_.back().section_offset - entries_.front().section_offset) / static_cast<double>(entries_.size() - 1);
+
+	j["interval"] = {
+		{"min", seconds(min_interval)},
+		{"max", seconds(max_interval)},
+		{"average", average / bytes_per_second},
+	};
+	// 直前のセクションの先頭を逃した直後から録画しても、次のセクションが揃うまでの時間
+	j["minimum_capture"] = seconds(max_interval + span);
+
+	return j.dump(4);
+}
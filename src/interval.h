@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+// 入力を最後まで読み、NITセクションの送出間隔と最初のセクションが揃うまでの時間を測る
+// 入力上の位置をPCRから求めたビットレートで時間に換算する
+class Interval
+{
+public:
+	Interval(const Config& config) : config_(config) {}
+	virtual ~Interval() = default;
+
+	// 結果と確実にNITを含む最短の録画時間をJSONで返す
+	std::string run();
+
+private:
+	struct Entry
+	{
+		uint64_t section_offset = 0;
+		uint64_t complete_offset = 0;
+	};
+
+	const Config& config_;
+	std::vector<Entry> entries_;
+};
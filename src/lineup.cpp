@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "chset.h"
+#include "convert.h"
+#include "lineup.h"
+#include "TSNITSection.h"
+
+ChSets Lineup::chsets(const TS::NITSection& nit, int32_t sorting)
+{
+	ChSets chsets;
+	size_t unindexed = 0;
+	size_t unlisted = 0;
+	for (const auto& t : nit.transport_descriptors())
+	{
+		// 地上波等のTSIDはBS/CSの固定の配置に当てはめない
+		if (ChSets::is_satellite(t.original_network_id()))
+		{
+			chsets.set_transport_stream_id(t.transport_stream_id());
+		}
+		const auto& d = t.satellite_delivery_system_descriptor();
+		if (d.descriptor_tag() == 0x43)
+		{
+			// 周波数は10kHz単位
+			if (!chsets.network().add(t.original_network_id(), d.frequency() * 10, t.transport_stream_id(),
+				d.orbital_position(), d.west_east_flag(), d.polarisation()))
+			{
+				unlisted++;
+			}
+		}
+		for (const auto& s : t.service_list_descriptor().service_lists())
+		{
+			if (!chsets.add_service(s.service_id(), t.original_network_id(), t.transport_stream_id(), s.service_type()))
+			{
+				unindexed++;
+			}
+		}
+	}
+	if (unlisted)
+	{
+		std::cerr << "warning: " << unlisted << " transport streams not added to the transponder list"
+			<< " (more than " << Network::MAX_TRANSPONDERS << " transponders or " << Network::MAX_TS << " TSIDs per transponder)\n";
+	}
+	if (unindexed)
+	{
+		// 出力は続け、索引から漏れたサービスのみ知らせる
+		std::cerr << "warning: " << unindexed << " services not indexed"
+			<< " (TSID not found in any transponder or more than " << ServiceIndex::MAX_SERVICES << " services)\n";
+	}
+	if (sorting)
+	{
+		chsets.sort_relative_ts_number(sorting);
+	}
+
+	return chsets;
+}
+
+std::string Lineup::label(const std::string& input)
+{
+	// 入力名から出力ファイル名に使える名前を作成
+	// /rec/bs.ts -> bs.ts, udp://239.0.0.1:5004 -> udp_239.0.0.1_5004
+	auto name = input;
+	auto pos = name.find("://");
+	if (pos == std::string::npos)
+	{
+		pos = name.find_last_of("/\\");
+		if (pos != std::string::npos)
+		{
+			name = name.substr(pos + 1);
+		}
+	}
+
+	for (auto& c : name)
+	{
+		if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-')
+		{
+			c = '_';
+		}
+	}
+	while (name.find("__") != std::string::npos)
+	{
+		name.erase(name.find("__"), 1);
+	}
+
+	return name;
+}
+
+std::string Lineup::output_path(const std::string& dir, const std::string& label, const std::string& format)
+{
+	return output_file(dir, label + '_' + Convert::get_filename(format));
+}
+
+std::string Lineup::output_file(const std::string& dir, const std::string& name)
+{
+	auto path = dir.empty() ? std::string(".") : dir;
+	if (path.back() != '/' && path.back() != '\\')
+	{
+		path += '/';
+	}
+
+	return path + name;
+}
+
+std::string Lineup::capsule(const TS::NITSection& nit)
+{
+	// NITのパケットのみのTS
+	// 最後のパケットも同期できるよう末尾にヌルパケットを1つ加える
+	const auto& packets = nit.packets();
+	std::string data(packets.begin(), packets.end());
+	data += std::string("\x47\x1f\xff\x10", TS::Packet::header_size());
+	data.append(TS::Packet::payload_size(), '\xff');
+
+	return data;
+}
+
+void Lineup::write(const std::string& filename, const std::string& data)
+{
+	std::ofstream ofs(filename, std::ios::binary);
+	if (!ofs)
+	{
+		throw std::runtime_error("failed to open " + filename);
+	}
+	ofs.write(data.data(), data.size());
+}
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "chset.h"
+#include "TSNITSection.h"
+
+// NITから得たチャンネル構成の作成と出力
+class Lineup
+{
+public:
+	Lineup() = delete;
+	~Lineup() = delete;
+
+	static ChSets chsets(const TS::NITSection& nit, int32_t sorting);
+	static std::string label(const std::string& input);
+	static std::string output_path(const std::string& dir, const std::string& label, const std::string& format);
+	static std::string output_file(const std::string& dir, const std::string& name);
+	static std::string capsule(const TS::NITSection& nit);
+	static void write(const std::string& filename, const std::string& data);
+};
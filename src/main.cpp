@@ -5,14 +5,89 @@
 #include <exception>
 #include <stdexcept>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "json.hpp"
+
+#include "batch.h"
+#include "bisect.h"
+#include "budget.h"
+#include "cache.h"
+#include "check.h"
 #include "chset.h"
+#include "classify.h"
 #include "config.h"
 #include "convert.h"
+#include "follow.h"
+#include "index.h"
+#include "input.h"
+#include "interval.h"
+#include "lineup.h"
+#include "monitor.h"
+#include "parallel.h"
+#include "probe.h"
+#include "profile.h"
 #include "TSNITSection.h"
+#include "watch.h"
+
+namespace
+{
+	void scan(const Config& config, Budget& budget, TS::NITSection& nit)
+	{
+		if (config.use_index())
+		{
+			// 索引のパケットのみを読み、入力が変わっていた場合は走査する
+			Index index(config);
+			if (index.load(nit)) { return; }
+			std::cerr << config.index_file() << " does not match " << config.input() << ", scanning\n";
+			nit.reset();
+		}
+		if (config.follow() || !config.checkpoint().empty())
+		{
+			Follow follow(config);
+			follow.run(nit, budget);
+		}
+		else if (config.probe() > 0)
+		{
+			Probe probe(config.input(), config.probe_window(), config.buffer_size(), config.timeout());
+			if (!probe.run(config.probe(), nit))
+			{
+				throw std::runtime_error("NIT packets not found. Check recorded channel or time.\n"
+					"read " + std::to_string(probe.input_bytes()) + " bytes in " + std::to_string(probe.windows()) + " windows");
+			}
+		}
+		else if (config.parallel() > 1)
+		{
+			ParallelScan scan(config.input(), config.parallel(), config.buffer_size(), config.timeout());
+			if (!scan.run(nit))
+			{
+				throw std::runtime_error("NIT packets not found. Check recorded channel or time.\n"
+					"read " + std::to_string(scan.input_bytes()) + " bytes");
+			}
+		}
+		else
+		{
+			auto input = Input::open(config);
+			input->set_max_bytes(config.max_bytes());
 
+			// 検査や集計をする場合は最初のNITを保持して入力の最後まで読む
+			while (input->feed(nit))
+			{
+				if (nit.on_update() && !config.full_scan()) { break; }
+				if (budget.exhausted(nit)) { break; }
+			}
+
+			// セクション入力はパケットを数えないため入力側の進捗で報告する
+			auto progress = input->progress();
+			if (!nit.on_update() && !progress.empty())
+			{
+				throw std::runtime_error("NIT sections not found. Check the section dump.\n" + budget.report(progress));
+			}
+		}
+	}
+}
 
 int main(int argc, char* argv[])
 {
@@ -20,36 +95,141 @@ int main(int argc, char* argv[])
 	{
 		Config config;
 		TS::NITSection nit;
-		ChSets chsets;
-		std::vector<uint8_t> buf;
 
 		config.parse(argc, argv);
-		buf.resize(config.buffer_size());
+		if (config.cache_clear())
+		{
+			Cache cache(config.cache_dir());
+			size_t count = 0;
+			if (config.inputs().empty())
+			{
+				count = cache.clear();
+			}
+			for (const auto& input : config.inputs())
+			{
+				auto key = Cache::key(input);
+				count += (!key.empty() && cache.remove(key)) ? 1 : 0;
+			}
+			std::cerr << "removed " << count << " cache entries\n";
+			return 0;
+		}
+
+		if (config.classify())
+		{
+			Classify classify(config);
+			return classify.run();
+		}
+
+		if (config.watch())
+		{
+			Watch watch(config);
+			return watch.run();
+		}
+
+		if (config.jobs())
+		{
+			Batch batch(config);
+			return batch.run();
+		}
+
+		if (config.multi())
+		{
+			Monitor monitor(config);
+			return monitor.run();
+		}
+
+		if (config.bisect())
+		{
+			Bisect bisect(config);
+			auto data = bisect.run() + '\n';
+			std::fwrite(data.c_str(), data.size(), 1, config.fp_output());
+			return 0;
+		}
+
+		if (config.nit_interval())
+		{
+			Interval interval(config);
+			auto data = interval.run() + '\n';
+			std::fwrite(data.c_str(), data.size(), 1, config.fp_output());
+			return 0;
+		}
+
+		if (config.index())
+		{
+			Index index(config);
+			auto data = index.run() + '\n';
+			std::fwrite(data.c_str(), data.size(), 1, config.fp_output());
+			return 0;
+		}
+
+		// 前回と同じファイルであれば走査せずに保存済みのNITを使う
+		std::unique_ptr<Cache> cache;
+		std::string key;
+		if (!config.cache_dir().empty() && !config.full_scan() && config.input() != "-" && !Input::is_stream(config.input()))
+		{
+			cache = std::make_unique<Cache>(config.cache_dir());
+			key = Cache::key(config.input());
+		}
+
+		Budget budget(config.max_bytes(), config.timeout());
+		Check check;
+		Profile profile;
+		if (config.full_scan())
+		{
+			nit.set_packet_handler([&config, &check, &profile](const TS::NITSection& packet, const uint8_t* buf, size_t size) {
+				if (config.check()) { check.push(packet, buf, size); }
+				if (config.profile()) { profile.push(buf, size); }
+			});
+			nit.set_hold_first(true);
+		}
+
+		auto cached = !key.empty() && cache->load(key, nit);
+		if (!cached)
+		{
+			scan(config, budget, nit);
+		}
 
-		while (true)
+		if (config.check())
 		{
-			auto size = std::fread(buf.data(), 1, buf.size(), config.fp_input());
-			if (size == 0) { break; }
-			nit.push(buf.data(), size);
-			if (nit.on_update()) { break; }
+			std::cerr << check.report();
+		}
+		if (config.profile())
+		{
+			Lineup::write(config.profile_output(), profile.json().dump(4) + '\n');
 		}
 
 		if (nit.on_update())
 		{
-			for (const auto& t : nit.transport_descriptors())
+			if (!key.empty() && !cached)
 			{
-				chsets.set_transport_stream_id(t.transport_stream_id());
+				cache->store(key, nit);
 			}
-			if (config.sorting())
+
+			if (!config.extract_nit().empty())
 			{
-				chsets.sort_relative_ts_number(config.sorting());
+				Lineup::write(config.extract_nit(), Lineup::capsule(nit));
 			}
+
+			auto chsets = Lineup::chsets(nit, config.sorting());
+			if (config.service() >= 0)
+			{
+				// 出力形式の代わりにサービスの索引を引いた結果を出力する
+				auto service = chsets.find_service(static_cast<uint16_t>(config.service()));
+				if (!service)
+				{
+					throw std::runtime_error("service_id " + std::to_string(config.service()) + " not found in the NIT");
+				}
+				auto data = nlohmann::json(*service).dump(4) + '\n';
+				std::fwrite(data.c_str(), data.size(), 1, config.fp_output());
+				return 0;
+			}
+
 			auto data = Convert::dump(config.format(), chsets);
 			std::fwrite(data.c_str(), data.size(), 1, config.fp_output());
 		}
 		else
 		{
-			throw std::runtime_error("NIT packets not found. Check recorded channel or time.");
+			throw std::runtime_error("NIT packets not found. Check recorded channel or time.\n" + budget.report(nit));
 		}
 	}
 	catch(const std::exception& e)
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#include "convert.h"
+#include "input.h"
+#include "lineup.h"
+#include "monitor.h"
+
+#if !defined(_WIN32)
+int32_t Monitor::run()
+{
+	streams_.resize(config_.inputs().size());
+	for (size_t i = 0; i < streams_.size(); i++)
+	{
+		streams_[i].name = config_.inputs()[i];
+		streams_[i].input = Input::open_nonblock(streams_[i].name, config_.buffer_size());
+		streams_[i].input->set_max_bytes(config_.max_bytes());
+		streams_[i].budget = std::make_unique<Budget>(config_.max_bytes(), config_.timeout());
+	}
+
+	auto epfd = ::epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0)
+	{
+		throw std::runtime_error("failed to create epoll");
+	}
+
+	for (size_t i = 0; i < streams_.size(); i++)
+	{
+		auto fd = streams_[i].input->fd();
+		if (fd < 0) { continue; }
+
+		epoll_event ev{};
+		ev.events = EPOLLIN;
+		ev.data.u64 = i;
+		if (::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+		{
+			::close(epfd);
+			throw std::runtime_error("failed to watch " + streams_[i].name);
+		}
+	}
+
+	int32_t failed = 0;
+	size_t active = streams_.size();
+	std::vector<epoll_event> events(streams_.size());
+	auto progressed = true;
+	while (active > 0)
+	{
+		// epollで待機できない入力(通常ファイル等)が残っている場合、
+		// 前回読み込めた場合は待機せず、読み込めなかった場合は短く待機して空回りを避ける
+		auto timeout = WAIT_MS;
+		for (const auto& s : streams_)
+		{
+			if (!s.done && s.input->fd() < 0)
+			{
+				timeout = progressed ? 0 : IDLE_MS;
+				break;
+			}
+		}
+		progressed = false;
+
+		auto count = ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), timeout);
+		for (auto i = 0; i < count; i++)
+		{
+			auto& s = streams_[events[i].data.u64];
+			if (s.done) { continue; }
+			if (!feed(s))
+			{
+				::epoll_ctl(epfd, EPOLL_CTL_DEL, s.input->fd(), nullptr);
+				failed += s.ok ? 0 : 1;
+				active--;
+			}
+		}
+
+		// 待機中の入力も含めて打ち切り条件を確認
+		for (auto& s : streams_)
+		{
+			if (s.done) { continue; }
+			auto bytes = s.nit.input_bytes();
+			auto fed = s.input->fd() >= 0 || feed(s);
+			progressed = progressed || s.nit.input_bytes() != bytes;
+			if (!fed || (!s.done && expired(s)))
+			{
+				if (s.input->fd() >= 0)
+				{
+					::epoll_ctl(epfd, EPOLL_CTL_DEL, s.input->fd(), nullptr);
+				}
+				failed += s.ok ? 0 : 1;
+				active--;
+			}
+		}
+	}
+
+	::close(epfd);
+
+	return failed ? 1 : 0;
+}
+#else
+int32_t Monitor::run()
+{
+	throw std::runtime_error("--multi is not supported on this platform");
+}
+#endif
+
+bool Monitor::feed(Stream& stream)
+{
+	// 入力を読み込み、NITが揃うか入力が終了した場合はfalseを返す
+	try
+	{
+		if (!stream.input->feed(stream.nit))
+		{
+			stream.done = true;
+			std::cerr << stream.name << ": NIT packets not found. Check recorded channel or time. "
+				<< stream.budget->report(stream.nit) << '\n';
+			return false;
+		}
+
+		if (stream.nit.on_update())
+		{
+			stream.done = true;
+			auto chsets = Lineup::chsets(stream.nit, config_.sorting());
+			auto filename = Lineup::output_path(config_.output_dir(), Lineup::label(stream.name), config_.format());
+			Lineup::write(filename, Convert::dump(config_.format(), chsets));
+			stream.ok = true;
+			std::cerr << stream.name << ": " << filename << '\n';
+			return false;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		stream.done = true;
+		std::cerr << stream.name << ": " << e.what() << '\n';
+		return false;
+	}
+
+	return true;
+}
+
+bool Monitor::expired(Stream& stream)
+{
+	if (!stream.budget->exhausted(stream.nit)) { return false; }
+
+	stream.done = true;
+	std::cerr << stream.name << ": NIT packets not found. Check recorded channel or time. "
+		<< stream.budget->report(stream.nit) << '\n';
+
+	return true;
+}
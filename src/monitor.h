@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "budget.h"
+#include "config.h"
+#include "input.h"
+#include "TSNITSection.h"
+
+// 複数の入力をepollで1スレッドで監視し、入力毎にチャンネル定義ファイルを出力する
+class Monitor
+{
+public:
+	Monitor(const Config& config) : config_(config) {}
+	virtual ~Monitor() = default;
+
+	int32_t run();
+
+private:
+	static constexpr int32_t WAIT_MS = 100;
+	// epollで待機できない入力(共有メモリ、展開中の圧縮ファイル)にデータがない場合の待機時間
+	static constexpr int32_t IDLE_MS = 10;
+
+	struct Stream
+	{
+		std::string name;
+		std::unique_ptr<Input> input;
+		std::unique_ptr<Budget> budget;
+		TS::NITSection nit;
+		bool done = false;
+		bool ok = false;
+	};
+
+	const Config& config_;
+	std::vector<Stream> streams_;
+
+	bool feed(Stream& stream);
+	bool expired(Stream& stream);
+};
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "json.hpp"
+
+#include "network.h"
+
+void Network::clear()
+{
+	size_ = 0;
+	transponder_index_.clear();
+	tsid_index_.clear();
+}
+
+bool Network::add(uint16_t network_id, uint32_t frequency_khz, uint16_t tsid,
+	uint16_t orbital_position, bool west_east_flag, uint8_t polarisation)
+{
+	if (tsid == 0 || tsid == 0xffff)
+	{
+		return false;
+	}
+
+	auto index = transponder_index_.find(transponder_key(network_id, frequency_khz));
+	if (index == transponder_index_.EMPTY)
+	{
+		if (size_ == transponders_.size()) { return false; }
+		index = static_cast<uint16_t>(size_);
+		if (!transponder_index_.insert(transponder_key(network_id, frequency_khz), index)) { return false; }
+
+		auto& t = transponders_[size_++];
+		t = Transponder();
+		t.network_id = network_id;
+		t.frequency_khz = frequency_khz;
+		t.orbital_position = orbital_position;
+		t.west_east_flag = west_east_flag;
+		t.polarisation = polarisation;
+	}
+
+	auto& t = transponders_[index];
+	auto last = t.transport_stream_id.begin() + t.ts_count;
+	if (std::find(t.transport_stream_id.begin(), last, tsid) == last)
+	{
+		if (t.ts_count == t.transport_stream_id.size()) { return false; }
+		t.transport_stream_id[t.ts_count++] = tsid;
+	}
+
+	return tsid_index_.insert(tsid_key(network_id, tsid), index);
+}
+
+const Network::Transponder* Network::find(uint16_t network_id, uint32_t frequency_khz) const
+{
+	auto index = transponder_index_.find(transponder_key(network_id, frequency_khz));
+
+	return index == transponder_index_.EMPTY ? nullptr : &transponders_[index];
+}
+
+const Network::Transponder* Network::find_tsid(uint16_t network_id, uint16_t tsid) const
+{
+	auto index = tsid_index_.find(tsid_key(network_id, tsid));
+
+	return index == tsid_index_.EMPTY ? nullptr : &transponders_[index];
+}
+
+nlohmann::json Network::json() const
+{
+	auto j = nlohmann::json::array();
+	for (const auto& t : *this)
+	{
+		j.push_back({
+			{"network_id", t.network_id},
+			{"frequency_khz", t.frequency_khz},
+			{"orbital_position", t.orbital_position},
+			{"west_east_flag", t.west_east_flag},
+			{"polarisation", t.polarisation},
+			{"transport_stream_id", std::vector<uint16_t>(t.transport_stream_id.begin(), t.transport_stream_id.begin() + t.ts_count)},
+		});
+	}
+
+	return j;
+}
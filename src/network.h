@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "json.hpp"
+
+// 64ビットのキーから16ビットの値を引くオープンアドレス法の固定長ハッシュ表
+template <size_t Slots>
+class FlatIndex
+{
+public:
+	static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+	static constexpr uint16_t EMPTY = 0xffff;
+
+	FlatIndex() { clear(); }
+	~FlatIndex() = default;
+
+	size_t size() const { return size_; }
+
+	void clear()
+	{
+		values_.fill(EMPTY);
+		size_ = 0;
+	}
+
+	// 同じキーは置き換え、埋まっている割合が1/2を超える場合はfalse
+	bool insert(uint64_t key, uint16_t value)
+	{
+		for (auto i = hash(key);; i = (i + 1) & (Slots - 1))
+		{
+			if (values_[i] == EMPTY)
+			{
+				if ((size_ + 1) * 2 > Slots) { return false; }
+				keys_[i] = key;
+				values_[i] = value;
+				size_++;
+				return true;
+			}
+			if (keys_[i] == key)
+			{
+				values_[i] = value;
+				return true;
+			}
+		}
+	}
+
+	// 見つからない場合はEMPTY
+	uint16_t find(uint64_t key) const
+	{
+		for (auto i = hash(key);; i = (i + 1) & (Slots - 1))
+		{
+			if (values_[i] == EMPTY || keys_[i] == key) { return values_[i]; }
+		}
+	}
+
+private:
+	std::array<uint64_t, Slots> keys_{};
+	std::array<uint16_t, Slots> values_{};
+	size_t size_ = 0;
+
+	static size_t hash(uint64_t key)
+	{
+		// フィボナッチハッシュで上位ビットを使う
+		return static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> 40) & (Slots - 1);
+	}
+};
+
+// NITのTSループから作る、(network_id, 周波数)毎のトランスポンダの一覧
+// BS/CSの固定の配置によらず、衛星分配システム記述子の周波数で区別する
+class Network
+{
+public:
+	static constexpr size_t MAX_TRANSPONDERS = 64;
+	static constexpr size_t MAX_TS = 8;
+
+	struct Transponder
+	{
+		uint16_t network_id = 0;
+		uint32_t frequency_khz = 0;
+		uint16_t orbital_position = 0;
+		bool west_east_flag = false;
+		uint8_t polarisation = 0;
+		std::array<uint16_t, MAX_TS> transport_stream_id{};
+		size_t ts_count = 0;
+	};
+
+	Network() = default;
+	~Network() = default;
+
+	const Transponder* begin() const { return transponders_.data(); }
+	const Transponder* end() const { return transponders_.data() + size_; }
+	size_t size() const { return size_; }
+
+	void clear();
+	// 同じ(network_id, 周波数)のトランスポンダにTSIDを加える、表が一杯の場合はfalse
+	bool add(uint16_t network_id, uint32_t frequency_khz, uint16_t tsid,
+		uint16_t orbital_position = 0, bool west_east_flag = false, uint8_t polarisation = 0);
+	const Transponder* find(uint16_t network_id, uint32_t frequency_khz) const;
+	const Transponder* find_tsid(uint16_t network_id, uint16_t tsid) const;
+	nlohmann::json json() const;
+
+private:
+	std::array<Transponder, MAX_TRANSPONDERS> transponders_;
+	size_t size_ = 0;
+	FlatIndex<MAX_TRANSPONDERS * 2> transponder_index_;
+	FlatIndex<MAX_TRANSPONDERS * MAX_TS * 2> tsid_index_;
+
+	static uint64_t transponder_key(uint16_t network_id, uint32_t frequency_khz)
+	{
+		return (static_cast<uint64_t>(network_id) << 32) | frequency_khz;
+	}
+	static uint64_t tsid_key(uint16_t network_id, uint16_t tsid)
+	{
+		return (static_cast<uint64_t>(network_id) << 16) | tsid;
+	}
+};
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "parallel.h"
+#include "TSNITSection.h"
+
+ParallelScan::ParallelScan(const std::string& input, int32_t threads, size_t buffer_size, double timeout) :
+	input_(input),
+	threads_(threads > 0 ? threads : 1),
+	buffer_size_(buffer_size),
+	has_deadline_(timeout > 0)
+{
+	if (has_deadline_)
+	{
+		deadline_ = std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+	}
+}
+
+#if !defined(_WIN32)
+bool ParallelScan::run(TS::NITSection& nit)
+{
+	auto fd = ::open(input_.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("failed to open " + input_);
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		::close(fd);
+		throw std::runtime_error("--parallel requires a regular file");
+	}
+
+	// 先頭で判定したパケット長の境界に揃えた範囲に分割
+	uint64_t file_size = static_cast<uint64_t>(st.st_size);
+	std::vector<uint8_t> head(static_cast<size_t>(std::min<uint64_t>(file_size, STRIDE_DETECT_BYTES)));
+	auto head_size = ::pread(fd, head.data(), head.size(), 0);
+	uint64_t stride = TS::Packet::detect_stride(head.data(), head_size > 0 ? static_cast<size_t>(head_size) : 0);
+	uint64_t range = (file_size / threads_ + stride - 1) / stride * stride;
+	if (range < buffer_size_) { range = buffer_size_; }
+
+	std::vector<std::thread> threads;
+	for (uint64_t begin = 0; begin < file_size; begin += range)
+	{
+		threads.emplace_back(&ParallelScan::scan, this, fd, begin, std::min(begin + range, file_size), file_size, std::ref(nit));
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	::close(fd);
+
+	return found_;
+}
+
+void ParallelScan::scan(int fd, uint64_t begin, uint64_t end, uint64_t file_size, TS::NITSection& result)
+{
+	TS::NITSection nit;
+	std::vector<uint8_t> buf(buffer_size_);
+	// セクションの位置が入力の先頭からになるよう範囲の開始位置から数える
+	nit.restore(begin, {});
+
+	// 範囲の終端で組み立て中のセクションがあれば揃うまで次の範囲も読み込む
+	auto offset = begin;
+	while (!found_ && offset < file_size && (offset < end || nit.in_progress()))
+	{
+		if (has_deadline_ && std::chrono::steady_clock::now() >= deadline_) { break; }
+
+		auto size = ::pread(fd, buf.data(), buf.size(), static_cast<off_t>(offset));
+		if (size <= 0) { break; }
+		offset += static_cast<uint64_t>(size);
+		input_bytes_ += static_cast<uint64_t>(size);
+
+		nit.push(buf.data(), static_cast<size_t>(size));
+		if (nit.on_update())
+		{
+			// 最初にCRCまで揃ったNITを採用し、他のスレッドを止める
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!found_)
+			{
+				result = nit;
+				found_ = true;
+			}
+			break;
+		}
+	}
+}
+#else
+bool ParallelScan::run(TS::NITSection& nit)
+{
+	throw std::runtime_error("--parallel is not supported on this platform");
+}
+
+void ParallelScan::scan(int fd, uint64_t begin, uint64_t end, uint64_t file_size, TS::NITSection& result)
+{
+}
+#endif
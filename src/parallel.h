@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "TSNITSection.h"
+
+// 1つのTSファイルを分割し、複数スレッドでpreadしながら並列にNITを探す
+class ParallelScan
+{
+public:
+	ParallelScan(const std::string& input, int32_t threads, size_t buffer_size, double timeout);
+	virtual ~ParallelScan() = default;
+
+	bool run(TS::NITSection& nit);
+	uint64_t input_bytes() const { return input_bytes_; }
+
+private:
+	// パケット長の判定に読む先頭のバイト数
+	static constexpr size_t STRIDE_DETECT_BYTES = 64 * 1024;
+
+	std::string input_;
+	int32_t threads_ = 1;
+	size_t buffer_size_ = 0;
+	bool has_deadline_ = false;
+	std::chrono::steady_clock::time_point deadline_;
+
+	std::atomic<bool> found_ = false;
+	std::atomic<uint64_t> input_bytes_ = 0;
+	std::mutex mutex_;
+
+	void scan(int fd, uint64_t begin, uint64_t end, uint64_t file_size, TS::NITSection& result);
+};
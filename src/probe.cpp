@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "probe.h"
+#include "TSNITSection.h"
+
+#if !defined(_WIN32)
+Probe::Probe(const std::string& input, uint64_t window, size_t buffer_size, double timeout) :
+	input_(input),
+	window_(window ? window : WINDOW_SIZE),
+	has_deadline_(timeout > 0),
+	buf_(buffer_size)
+{
+	if (has_deadline_)
+	{
+		deadline_ = std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+	}
+
+	fd_ = ::open(input_.c_str(), O_RDONLY);
+	if (fd_ < 0)
+	{
+		throw std::runtime_error("failed to open " + input_);
+	}
+
+	struct stat st;
+	if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		::close(fd_);
+		throw std::runtime_error("--probe requires a regular file");
+	}
+	file_size_ = static_cast<uint64_t>(st.st_size);
+
+	// 窓をレコードの境界に揃えるため先頭からパケット長を判定する
+	std::vector<uint8_t> head(std::min<uint64_t>(file_size_, STRIDE_DETECT_BYTES));
+	auto size = ::pread(fd_, head.data(), head.size(), 0);
+	stride_ = TS::Packet::detect_stride(head.data(), size > 0 ? static_cast<size_t>(size) : 0);
+}
+
+Probe::~Probe()
+{
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+	}
+}
+
+bool Probe::run(int32_t count, TS::NITSection& nit)
+{
+	if (count < 1) { count = 1; }
+
+	// 窓の開始位置をパケット境界に揃えて等間隔に配置
+	auto span = file_size_ > window_ ? file_size_ - window_ : 0;
+	for (int32_t i = 0; i < count; i++)
+	{
+		auto offset = count > 1 ? span / (count - 1) * i : 0;
+		offset -= offset % stride_;
+		if (window(offset, nit)) { return true; }
+		if (has_deadline_ && std::chrono::steady_clock::now() >= deadline_) { break; }
+
+		// ファイルが小さく窓が重なる場合は残りを読まない
+		if (offset + window_ >= file_size_) { break; }
+	}
+
+	return false;
+}
+
+bool Probe::window(uint64_t offset, TS::NITSection& nit)
+{
+	// 窓毎に同期を取り直し、セクションの位置は入力の先頭から数える
+	nit.reset();
+	nit.restore(offset, {});
+	windows_++;
+
+	// 窓の終端で組み立て中のセクションがあれば、もう1窓分まで読み進める
+	auto end = std::min(offset + window_, file_size_);
+	auto limit = std::min(offset + window_ * 2, file_size_);
+	while (offset < limit && (offset < end || nit.in_progress()))
+	{
+		if (has_deadline_ && std::chrono::steady_clock::now() >= deadline_) { break; }
+
+		auto size = ::pread(fd_, buf_.data(), static_cast<size_t>(std::min<uint64_t>(buf_.size(), limit - offset)), static_cast<off_t>(offset));
+		if (size <= 0) { break; }
+		offset += static_cast<uint64_t>(size);
+		input_bytes_ += static_cast<uint64_t>(size);
+
+		nit.push(buf_.data(), static_cast<size_t>(size));
+		if (nit.on_update()) { return true; }
+	}
+
+	return false;
+}
+#else
+Probe::Probe(const std::string& input, uint64_t window, size_t buffer_size, double timeout)
+{
+	throw std::runtime_error("--probe is not supported on this platform");
+}
+
+Probe::~Probe()
+{
+}
+
+bool Probe::run(int32_t count, TS::NITSection& nit)
+{
+	return false;
+}
+
+bool Probe::window(uint64_t offset, TS::NITSection& nit)
+{
+	return false;
+}
+#endif
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TSNITSection.h"
+
+// 大きなTSファイルの離れた位置から一定量ずつpreadし、NITが揃う窓を探す
+// 読み込み量はファイルの大きさによらず窓の大きさ×窓の数で抑えられる
+class Probe
+{
+public:
+	// 既定の窓の大きさ、BSの1トランスポンダ(約52Mbps)で約10秒分
+	static constexpr uint64_t WINDOW_SIZE = 64 * 1024 * 1024;
+	// パケット長の判定に読む先頭のバイト数
+	static constexpr uint64_t STRIDE_DETECT_BYTES = 64 * 1024;
+
+	Probe(const std::string& input, uint64_t window, size_t buffer_size, double timeout);
+	virtual ~Probe();
+
+	// 先頭から終端まで等間隔にcount個の窓を順に調べる
+	bool run(int32_t count, TS::NITSection& nit);
+
+	// offsetから1窓分を読み込み、NITが揃った場合はtrueを返す
+	bool window(uint64_t offset, TS::NITSection& nit);
+
+	uint64_t file_size() const { return file_size_; }
+	uint64_t window_size() const { return window_; }
+	// 入力のパケット長、窓の開始位置はこの倍数に揃える
+	int32_t stride() const { return stride_; }
+	uint64_t input_bytes() const { return input_bytes_; }
+	int32_t windows() const { return windows_; }
+
+private:
+	std::string input_;
+	int fd_ = -1;
+	uint64_t file_size_ = 0;
+	uint64_t window_ = WINDOW_SIZE;
+	int32_t stride_ = 188;
+	bool has_deadline_ = false;
+	std::chrono::steady_clock::time_point deadline_;
+	std::vector<uint8_t> buf_;
+
+	uint64_t input_bytes_ = 0;
+	int32_t windows_ = 0;
+};
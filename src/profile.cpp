@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "json.hpp"
+
+#include "profile.h"
+#include "TSHeaderBatch.h"
+#include "TSPacket.h"
+
+Profile::Profile() :
+	pid_packets_(PID_COUNT),
+	pmt_pids_(PID_COUNT)
+{
+}
+
+void Profile::push(const uint8_t* buf, size_t size)
+{
+	auto count = size / TS::Packet::size();
+	batch_.decode(buf, count);
+
+	const auto& pids = batch_.pids();
+	const auto& flags = batch_.flags();
+	for (size_t i = 0; i < count; i++)
+	{
+		auto pid = pids[i];
+		pid_packets_[pid]++;
+
+		auto f = flags[i];
+		if (f & TS::HeaderBatch::TRANSPORT_ERROR) { continue; }
+
+		// PCRとPSIを持ち得るパケットのみ中身を読む
+		const auto* p = buf + i * TS::Packet::size();
+		if (f & TS::HeaderBatch::ADAPTATION_FIELD)
+		{
+			push_pcr(pid, p);
+		}
+		if ((f & TS::HeaderBatch::PAYLOAD_START) && (pid == PAT_PID || pmt_pids_[pid]))
+		{
+			push_psi(pid, p);
+		}
+	}
+	packets_ += count;
+}
+
+void Profile::push_pcr(uint16_t pid, const uint8_t* p)
+{
+	auto length = p[4];
+	if (length < 7 || !(p[5] & 0x10)) { return; }
+
+	uint64_t base = (static_cast<uint64_t>(p[6]) << 25) | (p[7] << 17) | (p[8] << 9) | (p[9] << 1) | (p[10] >> 7);
+	uint64_t ext = ((p[10] & 0x01) << 8) | p[11];
+	auto pcr = base * 300 + ext;
+
+	auto& clock = clocks_[pid];
+	if (clock.count > 0)
+	{
+		auto delta = (pcr + PCR_WRAP - clock.last) % PCR_WRAP;
+		if (delta < PCR_GAP)
+		{
+			clock.elapsed += delta;
+		}
+	}
+	clock.last = pcr;
+	clock.count++;
+}
+
+void Profile::push_psi(uint16_t pid, const uint8_t* p)
+{
+	auto start = TS::Packet::header_size();
+	if (p[3] & 0x20)
+	{
+		start += 1 + p[4];
+	}
+	if (start >= TS::Packet::size()) { return; }
+
+	// ポインタフィールドの後から始まり、このパケットに収まるセクションのみ
+	start += 1 + p[start];
+	if (start + 3 > TS::Packet::size()) { return; }
+	const auto* s = p + start;
+	int32_t total = 3 + (((s[1] & 0x0f) << 8) | s[2]);
+	if (total < 16 || start + total > TS::Packet::size()) { return; }
+	if (TS::Packet::crc32(s, total) != 0) { return; }
+
+	if (pid == PAT_PID && s[0] == 0x00)
+	{
+		for (int32_t i = 8; i + 4 <= total - 4; i += 4)
+		{
+			uint16_t program_number = (s[i] << 8) | s[i + 1];
+			uint16_t pmt_pid = ((s[i + 2] & 0x1f) << 8) | s[i + 3];
+			// 0はNITのPID
+			if (program_number == 0) { continue; }
+			services_[program_number].pmt_pid = pmt_pid;
+			pmt_pids_[pmt_pid] = true;
+		}
+	}
+	else if (s[0] == 0x02)
+	{
+		uint16_t program_number = (s[3] << 8) | s[4];
+		auto& service = services_[program_number];
+		service.pmt_pid = pid;
+		service.pcr_pid = ((s[8] & 0x1f) << 8) | s[9];
+		service.pids.clear();
+		service.has_pmt = true;
+
+		int32_t i = 12 + (((s[10] & 0x0f) << 8) | s[11]);
+		while (i + 5 <= total - 4)
+		{
+			service.pids.push_back(((s[i + 1] & 0x1f) << 8) | s[i + 2]);
+			i += 5 + (((s[i + 3] & 0x0f) << 8) | s[i + 4]);
+		}
+	}
+}
+
+double Profile::duration() const
+{
+	const Clock* best = nullptr;
+	for (const auto& [pid, clock] : clocks_)
+	{
+		if (!best || clock.count > best->count) { best = &clock; }
+	}
+
+	return best ? static_cast<double>(best->elapsed) / PCR_CLOCK : 0;
+}
+
+uint64_t Profile::bitrate(uint64_t packets, double duration) const
+{
+	return static_cast<uint64_t>(std::llround(packets * TS::Packet::size() * 8 / duration));
+}
+
+nlohmann::json Profile::json() const
+{
+	auto seconds = duration();
+
+	auto j = nlohmann::json::object();
+	j["packets"] = packets_;
+	j["duration"] = seconds > 0 ? nlohmann::json(seconds) : nlohmann::json();
+	if (seconds > 0)
+	{
+		j["bitrate"] = bitrate(packets_, seconds);
+	}
+
+	j["pids"] = nlohmann::json::array();
+	for (size_t pid = 0; pid < PID_COUNT; pid++)
+	{
+		if (pid_packets_[pid] == 0) { continue; }
+		auto e = nlohmann::json::object();
+		e["pid"] = pid;
+		e["packets"] = pid_packets_[pid];
+		if (seconds > 0)
+		{
+			e["bitrate"] = bitrate(pid_packets_[pid], seconds);
+		}
+		auto clock = clocks_.find(static_cast<uint16_t>(pid));
+		if (clock != clocks_.end())
+		{
+			e["pcrs"] = clock->second.count;
+		}
+		j["pids"].push_back(e);
+	}
+
+	// サービスのビットレートはPMTとPCR、各ストリームのPIDの合計
+	j["services"] = nlohmann::json::array();
+	for (const auto& [service_id, service] : services_)
+	{
+		auto pids = service.pids;
+		pids.push_back(service.pmt_pid);
+		if (service.has_pmt)
+		{
+			pids.push_back(service.pcr_pid);
+		}
+		std::sort(pids.begin(), pids.end());
+		pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+
+		uint64_t packets = 0;
+		for (auto pid : pids)
+		{
+			packets += pid_packets_[pid];
+		}
+
+		auto e = nlohmann::json::object();
+		e["service_id"] = service_id;
+		e["pmt_pid"] = service.pmt_pid;
+		e["pcr_pid"] = service.has_pmt ? nlohmann::json(service.pcr_pid) : nlohmann::json();
+		e["pids"] = service.pids;
+		e["packets"] = packets;
+		if (seconds > 0)
+		{
+			e["bitrate"] = bitrate(packets, seconds);
+		}
+		j["services"].push_back(e);
+	}
+
+	return j;
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "json.hpp"
+
+#include "TSHeaderBatch.h"
+#include "TSPacket.h"
+
+// 走査と同時にPID毎のパケット数とPCRを集計し、PID毎とサービス毎のビットレートを求める
+// サービスとPIDの対応は1パケットに収まるPAT/PMTのみから求める
+class Profile
+{
+public:
+	Profile();
+	virtual ~Profile() = default;
+
+	// 同期した188バイトのパケット列を渡す
+	void push(const uint8_t* buf, size_t size);
+
+	uint64_t packets() const { return packets_; }
+	// 最もPCRの多いPIDで求めた秒数、PCRがない場合は0
+	double duration() const;
+
+	nlohmann::json json() const;
+
+private:
+	static constexpr size_t PID_COUNT = 0x2000;
+	static constexpr uint16_t PAT_PID = 0x0000;
+	static constexpr uint64_t PCR_CLOCK = 27000000;
+	// PCRは33ビットの90kHzと9ビットの27MHzで表す
+	static constexpr uint64_t PCR_WRAP = (1ULL << 33) * 300;
+	// これより大きく進んだ、または戻った場合は不連続として経過時間に加えない
+	static constexpr uint64_t PCR_GAP = PCR_CLOCK * 10;
+
+	struct Clock
+	{
+		uint64_t count = 0;
+		uint64_t last = 0;
+		uint64_t elapsed = 0;
+	};
+
+	struct Service
+	{
+		uint16_t pmt_pid = 0;
+		uint16_t pcr_pid = 0;
+		std::vector<uint16_t> pids;
+		bool has_pmt = false;
+	};
+
+	TS::HeaderBatch batch_;
+	std::vector<uint64_t> pid_packets_;
+	std::vector<bool> pmt_pids_;
+	std::map<uint16_t, Clock> clocks_;
+	std::map<uint16_t, Service> services_;
+	uint64_t packets_ = 0;
+
+	void push_pcr(uint16_t pid, const uint8_t* p);
+	void push_psi(uint16_t pid, const uint8_t* p);
+	uint64_t bitrate(uint64_t packets, double duration) const;
+};
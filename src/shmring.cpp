@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "shmring.h"
+
+ShmRing::~ShmRing()
+{
+	unmap();
+}
+
+bool ShmRing::closed() const
+{
+	return header_ ? header_->closed.load(std::memory_order_acquire) != 0 : true;
+}
+
+uint64_t ShmRing::dropped() const
+{
+	return header_ ? header_->dropped.load(std::memory_order_relaxed) : 0;
+}
+
+size_t ShmRing::readable() const
+{
+	if (!header_) { return 0; }
+	auto head = header_->head.load(std::memory_order_acquire);
+	auto tail = header_->tail.load(std::memory_order_relaxed);
+	return static_cast<size_t>(head - tail);
+}
+
+void ShmRing::create(const std::string& name, size_t capacity)
+{
+	name_ = name;
+	capacity_ = capacity;
+	owner_ = true;
+	map(true);
+}
+
+void ShmRing::attach(const std::string& name)
+{
+	name_ = name;
+	owner_ = false;
+	map(false);
+}
+
+size_t ShmRing::write(const uint8_t* buf, size_t size)
+{
+	// 空きが足りない場合は書き込まない (録画側を読み込み側で止めないため)
+	auto head = header_->head.load(std::memory_order_relaxed);
+	auto tail = header_->tail.load(std::memory_order_acquire);
+	if (size > capacity_ - static_cast<size_t>(head - tail))
+	{
+		header_->dropped.fetch_add(size, std::memory_order_relaxed);
+		return 0;
+	}
+
+	auto offset = static_cast<size_t>(head % capacity_);
+	auto first = std::min(size, capacity_ - offset);
+	std::copy(buf, buf + first, data_ + offset);
+	std::copy(buf + first, buf + size, data_);
+	header_->head.store(head + size, std::memory_order_release);
+
+	return size;
+}
+
+size_t ShmRing::peek(const uint8_t** data) const
+{
+	// 折り返さずに読める連続領域を返す
+	auto head = header_->head.load(std::memory_order_acquire);
+	auto tail = header_->tail.load(std::memory_order_relaxed);
+	auto offset = static_cast<size_t>(tail % capacity_);
+	*data = data_ + offset;
+	return std::min(static_cast<size_t>(head - tail), capacity_ - offset);
+}
+
+void ShmRing::consume(size_t size)
+{
+	header_->tail.fetch_add(size, std::memory_order_release);
+}
+
+void ShmRing::close()
+{
+	if (header_)
+	{
+		header_->closed.store(1, std::memory_order_release);
+	}
+}
+
+#if !defined(_WIN32)
+void ShmRing::map(bool create)
+{
+	auto path = "/" + name_;
+	fd_ = create
+		? ::shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)
+		: ::shm_open(path.c_str(), O_RDWR, 0);
+	if (fd_ < 0)
+	{
+		throw std::runtime_error("failed to open shm:" + name_);
+	}
+
+	if (create)
+	{
+		map_size_ = DATA_OFFSET + capacity_;
+		if (::ftruncate(fd_, static_cast<off_t>(map_size_)) != 0)
+		{
+			throw std::runtime_error("failed to resize shm:" + name_);
+		}
+	}
+	else
+	{
+		struct stat st;
+		if (::fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) <= DATA_OFFSET)
+		{
+			throw std::runtime_error("invalid shm:" + name_);
+		}
+		map_size_ = static_cast<size_t>(st.st_size);
+	}
+
+	auto p = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (p == MAP_FAILED)
+	{
+		throw std::runtime_error("failed to mmap shm:" + name_);
+	}
+
+	data_ = static_cast<uint8_t*>(p) + DATA_OFFSET;
+	if (create)
+	{
+		header_ = new (p) Header();
+		header_->capacity = capacity_;
+		header_->magic = MAGIC;
+	}
+	else
+	{
+		header_ = static_cast<Header*>(p);
+		if (header_->magic != MAGIC || header_->capacity != map_size_ - DATA_OFFSET)
+		{
+			throw std::runtime_error("invalid shm:" + name_);
+		}
+		capacity_ = static_cast<size_t>(header_->capacity);
+	}
+}
+
+void ShmRing::unmap()
+{
+	if (header_)
+	{
+		::munmap(header_, map_size_);
+		header_ = nullptr;
+		data_ = nullptr;
+	}
+
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+		fd_ = -1;
+		if (owner_)
+		{
+			::shm_unlink(("/" + name_).c_str());
+		}
+	}
+}
+#else
+void ShmRing::map(bool create)
+{
+	throw std::runtime_error("shm input is not supported on this platform");
+}
+
+void ShmRing::unmap()
+{
+}
+#endif
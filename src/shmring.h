@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// 録画プロセスとTSを受け渡すPOSIX共有メモリ上のリングバッファ
+// 先頭ページにヘッダ、以降をデータ領域とし、head/tailは累積バイト数で管理する
+class ShmRing
+{
+public:
+	ShmRing() = default;
+	ShmRing(const ShmRing&) = delete;
+	ShmRing& operator=(const ShmRing&) = delete;
+	virtual ~ShmRing();
+
+	const std::string& name() const { return name_; }
+	size_t capacity() const { return capacity_; }
+	bool closed() const;
+	uint64_t dropped() const;
+	size_t readable() const;
+
+	void create(const std::string& name, size_t capacity);
+	void attach(const std::string& name);
+	size_t write(const uint8_t* buf, size_t size);
+	size_t peek(const uint8_t** data) const;
+	void consume(size_t size);
+	void close();
+
+private:
+	static constexpr uint32_t MAGIC = 0x50345242;	// "P4RB"
+	static constexpr size_t DATA_OFFSET = 4096;
+
+	struct Header
+	{
+		uint32_t magic;
+		std::atomic<uint32_t> closed;				// 書き込み終了
+		uint64_t capacity;
+		alignas(64) std::atomic<uint64_t> head;		// 書き込み位置
+		alignas(64) std::atomic<uint64_t> tail;		// 読み込み位置
+		std::atomic<uint64_t> dropped;				// 空き不足で破棄したバイト数
+	};
+	static_assert(std::atomic<uint64_t>::is_always_lock_free);
+	static_assert(sizeof(Header) <= DATA_OFFSET);
+
+	std::string name_;
+	size_t capacity_ = 0;
+	size_t map_size_ = 0;
+	bool owner_ = false;
+	int fd_ = -1;
+	Header* header_ = nullptr;
+	uint8_t* data_ = nullptr;
+
+	void map(bool create);
+	void unmap();
+};
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// TSヘッダの展開速度を実際の録画で測定するツール
+// パケット毎のTS::Headerと、配列に展開するTS::HeaderBatchを比較する
+
+#include <getopt.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TSHeader.h"
+#include "TSHeaderBatch.h"
+#include "TSPacket.h"
+
+namespace
+{
+
+constexpr size_t BLOCK_PACKETS = 1024;
+
+std::string usage(const std::string& argv0)
+{
+	return "\n"
+		"usage: " + argv0 + " [options] input\n"
+		"\n"
+		"options:\n"
+		"  --help            show this help message\n"
+		"  --max-bytes=int   bytes to load from the input (default 256MiB)\n"
+		"  --repeat=int      number of passes over the loaded packets (default 10)\n"
+		"  input             TS filename (188, 192 or 204 bytes per packet)\n";
+}
+
+std::vector<uint8_t> load(const std::string& input, uint64_t max_bytes)
+{
+	std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(input.c_str(), "rb"), &std::fclose);
+	if (!fp)
+	{
+		throw std::runtime_error("failed to open " + input);
+	}
+
+	// 188バイトに揃えたパケットのみを残す
+	TS::Packet packet;
+	std::vector<uint8_t> packets;
+	std::vector<uint8_t> buf(188 * BLOCK_PACKETS);
+	while (packet.input_bytes() < max_bytes)
+	{
+		auto size = std::fread(buf.data(), 1, buf.size(), fp.get());
+		if (size == 0) { break; }
+
+		auto sync_size = packet.sync(buf.data(), size);
+		packets.insert(packets.end(), packet.buffer().begin(), packet.buffer().begin() + sync_size);
+	}
+
+	return packets;
+}
+
+template <typename F>
+double measure(int32_t repeat, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (auto i = 0; i < repeat; i++)
+	{
+		f();
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	static struct option long_options[] = {
+		{"help", no_argument, 0, 'h'},
+		{"max-bytes", required_argument, 0, 'B'},
+		{"repeat", required_argument, 0, 'r'},
+		{0,0,0,0},
+	};
+
+	uint64_t max_bytes = 256 * 1024 * 1024;
+	int32_t repeat = 10;
+
+	try
+	{
+		while (true)
+		{
+			auto option_index = 0;
+			auto c = getopt_long(argc, argv, "hB:r:", long_options, &option_index);
+			if (c == -1) { break; }
+
+			switch (c)
+			{
+			case 'B':
+				max_bytes = std::stoull(optarg);
+				break;
+			case 'r':
+				repeat = std::stoi(optarg);
+				break;
+			case 'h':
+			default:
+				throw std::runtime_error(usage(argv[0]));
+			}
+		}
+		if (argc - optind != 1)
+		{
+			throw std::runtime_error(usage(argv[0]));
+		}
+
+		auto packets = load(argv[optind], max_bytes);
+		auto count = packets.size() / TS::Packet::size();
+		if (count == 0)
+		{
+			throw std::runtime_error("no TS packets found");
+		}
+
+		// パケット毎にHeaderへ展開
+		uint64_t scalar_sum = 0;
+		auto scalar = measure(repeat, [&] {
+			TS::Header header;
+			for (size_t i = 0; i < count; i++)
+			{
+				header.parse_ts_header(packets.data() + i * TS::Packet::size());
+				scalar_sum += header.pid() + header.continuity_counter()
+					+ (header.transport_error_indicator() ? TS::HeaderBatch::TRANSPORT_ERROR : 0)
+					+ (header.payload_start_indicator() ? TS::HeaderBatch::PAYLOAD_START : 0)
+					+ (header.adaptation_field_control() ? TS::HeaderBatch::ADAPTATION_FIELD : 0);
+			}
+		});
+
+		// 同期1回分程度のブロック毎に配列へ展開
+		uint64_t batch_sum = 0;
+		TS::HeaderBatch batch;
+		auto batched = measure(repeat, [&] {
+			for (size_t i = 0; i < count; i += BLOCK_PACKETS)
+			{
+				auto n = std::min(BLOCK_PACKETS, count - i);
+				batch.decode(packets.data() + i * TS::Packet::size(), n);
+				for (size_t j = 0; j < n; j++)
+				{
+					batch_sum += batch.pids()[j] + batch.continuity_counters()[j]
+						+ (batch.flags()[j] & (TS::HeaderBatch::TRANSPORT_ERROR | TS::HeaderBatch::PAYLOAD_START | TS::HeaderBatch::ADAPTATION_FIELD));
+				}
+			}
+		});
+
+		if (scalar_sum != batch_sum)
+		{
+			throw std::runtime_error("HeaderBatch does not match Header");
+		}
+
+		auto total = static_cast<double>(count) * repeat;
+		std::cout
+			<< "packets: " << count << " x " << repeat << '\n'
+			<< "Header:      " << total / scalar / 1e6 << " Mpackets/s\n"
+			<< "HeaderBatch: " << total / batched / 1e6 << " Mpackets/s"
+			<< (TS::HeaderBatch::simd() ? " (AVX2)" : " (scalar)") << '\n';
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+
+	return 0;
+}
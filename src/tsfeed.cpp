@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// px4chsetの入力を実機なしで確認するための送出ツール
+// TSファイルを共有メモリのリングバッファやUDP/RTPへ送出する
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shmring.h"
+
+namespace
+{
+
+constexpr size_t CHUNK_SIZE = 188 * 256;
+constexpr size_t DATAGRAM_PACKETS = 7;
+
+std::string usage(const std::string& argv0)
+{
+	return "\n"
+		"usage: " + argv0 + " [options] input output\n"
+		"\n"
+		"options:\n"
+		"  --help            show this help message\n"
+		"  --capacity=int    ring buffer size in bytes (default 32MiB, at least 48128)\n"
+		"  --linger=int      seconds to wait for the reader after EOF (default 10)\n"
+		"  --rate=int        udp/rtp send rate in bytes per second (default 4000000)\n"
+		"  input             input filename, '-': stdin\n"
+		"  output            'shm:name': shared memory ring\n"
+		"                    'udp://host:port', 'rtp://host:port': UDP/RTP stream\n";
+}
+
+void feed_shm(std::FILE* fp, const std::string& name, size_t capacity, int32_t linger)
+{
+	ShmRing ring;
+	ring.create(name, capacity);
+
+	std::vector<uint8_t> buf(CHUNK_SIZE);
+	while (true)
+	{
+		auto size = std::fread(buf.data(), 1, buf.size(), fp);
+		if (size == 0) { break; }
+
+		// 試験用なので空きができるまで待つ
+		while (size > capacity - ring.readable())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		ring.write(buf.data(), size);
+	}
+	ring.close();
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(linger);
+	while (ring.readable() > 0 && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+void feed_udp(std::FILE* fp, const std::string& address, bool rtp, size_t rate)
+{
+	auto pos = address.rfind(':');
+	if (pos == std::string::npos)
+	{
+		throw std::runtime_error("invalid address " + address);
+	}
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(static_cast<uint16_t>(std::stoi(address.substr(pos + 1))));
+	if (::inet_pton(AF_INET, address.substr(0, pos).c_str(), &addr.sin_addr) != 1)
+	{
+		throw std::runtime_error("invalid address " + address);
+	}
+
+	auto fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+	{
+		throw std::runtime_error("failed to create socket");
+	}
+
+	// 1データグラムに7パケット、RTPの場合はMP2T(PT=33)のヘッダを付加
+	std::vector<uint8_t> buf(12 + DATAGRAM_PACKETS * 188);
+	uint16_t seq = 0;
+	uint64_t sent = 0;
+	auto start = std::chrono::steady_clock::now();
+	auto header = rtp ? 12 : 0;
+	while (true)
+	{
+		auto size = std::fread(buf.data() + header, 1, DATAGRAM_PACKETS * 188, fp);
+		if (size == 0) { break; }
+
+		if (rtp)
+		{
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			auto timestamp = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() * 9 / 100);
+			buf[0] = 0x80;
+			buf[1] = 33;
+			buf[2] = seq >> 8;
+			buf[3] = seq & 0xff;
+			buf[4] = timestamp >> 24;
+			buf[5] = (timestamp >> 16) & 0xff;
+			buf[6] = (timestamp >> 8) & 0xff;
+			buf[7] = timestamp & 0xff;
+			std::fill(buf.begin() + 8, buf.begin() + 12, 0);
+			seq++;
+		}
+		::sendto(fd, buf.data(), header + size, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		sent += size;
+
+		if (rate > 0)
+		{
+			auto due = start + std::chrono::microseconds(sent * 1000000 / rate);
+			std::this_thread::sleep_until(due);
+		}
+	}
+
+	::close(fd);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const option long_options[] = {
+			{"help", no_argument, 0, 'h'},
+			{"capacity", required_argument, 0, 'c'},
+			{"linger", required_argument, 0, 'l'},
+			{"rate", required_argument, 0, 'r'},
+			{0,0,0,0},
+		};
+
+		size_t capacity = 32 * 1024 * 1024;
+		int32_t linger = 10;
+		size_t rate = 4000000;
+		while (true)
+		{
+			auto option_index = 0;
+			auto c = getopt_long(argc, argv, "hc:l:r:", long_options, &option_index);
+			if (c == -1) { break; }
+
+			switch (c)
+			{
+			case 'c':
+				capacity = std::stoul(optarg);
+				// 1回に書き込む分が入らないとリングが空くのを待ち続ける
+				if (capacity < CHUNK_SIZE)
+				{
+					throw std::runtime_error("--capacity must be at least " + std::to_string(CHUNK_SIZE) + " bytes");
+				}
+				break;
+			case 'l':
+				linger = std::stoi(optarg);
+				break;
+			case 'r':
+				rate = std::stoul(optarg);
+				break;
+			case 'h':
+			default:
+				throw std::runtime_error(usage(argv[0]));
+			}
+		}
+
+		if (argc - optind != 2)
+		{
+			throw std::runtime_error(usage(argv[0]));
+		}
+
+		std::string input = argv[optind];
+		std::string output = argv[optind + 1];
+		std::FILE* fp = (input == "-") ? stdin : std::fopen(input.c_str(), "rb");
+		if (!fp)
+		{
+			throw std::runtime_error("failed to open " + input);
+		}
+
+		if (output.rfind("shm:", 0) == 0)
+		{
+			feed_shm(fp, output.substr(4), capacity, linger);
+		}
+		else if (output.rfind("udp://", 0) == 0 || output.rfind("rtp://", 0) == 0)
+		{
+			feed_udp(fp, output.substr(6), output[0] == 'r', rate);
+		}
+		else
+		{
+			throw std::runtime_error("unknown output " + output);
+		}
+
+		if (fp != stdin)
+		{
+			std::fclose(fp);
+		}
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "lineup.h"
+#include "TSNITSection.h"
+#include "watch.h"
+
+namespace
+{
+	std::atomic<bool> interrupted = false;
+
+	void on_signal(int)
+	{
+		interrupted = true;
+	}
+}
+
+#if !defined(_WIN32)
+int32_t Watch::run()
+{
+	auto fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+	{
+		throw std::runtime_error("failed to initialize inotify");
+	}
+
+	// 出力を監視対象に書き込むと自身の出力を走査し続けるため禁止する
+	std::map<int, std::string> dirs;
+	for (const auto& dir : config_.inputs())
+	{
+		std::error_code ec;
+		if (!std::filesystem::is_directory(dir) || std::filesystem::equivalent(dir, config_.output_dir(), ec))
+		{
+			::close(fd);
+			throw std::runtime_error(dir + " is not a directory or is the output directory");
+		}
+
+		// 書き込みが終わったファイルと、別の場所から移動してきたファイルを対象にする
+		auto wd = ::inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0)
+		{
+			::close(fd);
+			throw std::runtime_error("failed to watch " + dir);
+		}
+		dirs[wd] = dir;
+	}
+
+	std::signal(SIGINT, on_signal);
+	std::signal(SIGTERM, on_signal);
+
+	for (auto i = 0; i < config_.jobs(); i++)
+	{
+		threads_.emplace_back(&Watch::worker, this);
+	}
+
+	std::vector<uint8_t> buf(64 * 1024);
+	while (!interrupted)
+	{
+		pollfd pfd{fd, POLLIN, 0};
+		if (::poll(&pfd, 1, WAIT_MS) <= 0) { continue; }
+
+		auto size = ::read(fd, buf.data(), buf.size());
+		for (ssize_t pos = 0; pos < size;)
+		{
+			const auto* ev = reinterpret_cast<const inotify_event*>(buf.data() + pos);
+			pos += sizeof(inotify_event) + ev->len;
+
+			// 書き込み途中の一時ファイルとして隠しファイルは対象外
+			if ((ev->mask & IN_ISDIR) || ev->len == 0 || ev->name[0] == '.') { continue; }
+
+			auto it = dirs.find(ev->wd);
+			if (it == dirs.end()) { continue; }
+			enqueue((std::filesystem::path(it->second) / ev->name).string());
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	for (auto& t : threads_)
+	{
+		t.join();
+	}
+
+	::close(fd);
+
+	return 0;
+}
+#else
+int32_t Watch::run()
+{
+	throw std::runtime_error("--watch is not supported on this platform");
+}
+#endif
+
+void Watch::worker()
+{
+	// NITSectionと読み込みバッファはスレッド毎に使い回す
+	TS::NITSection nit;
+	std::vector<uint8_t> buf(config_.buffer_size());
+
+	while (true)
+	{
+		Batch::Result result;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+			if (stop_) { break; }
+
+			result.input = queue_.front();
+			queue_.pop_front();
+		}
+
+		result.label = Lineup::label(result.input);
+		batch_.process(result, nit, buf);
+	}
+}
+
+void Watch::enqueue(const std::string& input)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.emplace_back(input);
+	}
+	cv_.notify_one();
+}
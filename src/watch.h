@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "config.h"
+
+// ディレクトリをinotifyで監視し、書き込みが終わったファイルを常駐するスレッドで走査する
+class Watch
+{
+public:
+	Watch(const Config& config) : config_(config), batch_(config) {}
+	virtual ~Watch() = default;
+
+	// SIGINTまたはSIGTERMを受け取るまで監視を続ける
+	int32_t run();
+
+private:
+	static constexpr int32_t WAIT_MS = 100;
+
+	const Config& config_;
+	Batch batch_;
+
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::string> queue_;
+	bool stop_ = false;
+
+	void worker();
+	void enqueue(const std::string& input);
+};